@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "spell_checker.h"
+
+// Scale benchmark: generates dictionaries of pronounceable words and typo
+// queries at controlled edit distances, then loads every dictionary once
+// per suggestion engine and reports one record per engine and typo
+// distance as CSV or JSON lines. Exits non-zero if an exact lookup gives a
+// wrong answer or the engines disagree on a suggestion list.
+
+// Typo distances measured; the last one lies beyond the default maxDistance
+#define MAX_EDITS 3
+// Exact lookups timed per dictionary, hits and misses each
+#define LOOKUPS 1000000
+
+typedef struct EngineInfo {
+    const char* name;
+    SuggestEngine engine;
+} EngineInfo;
+
+static const EngineInfo engines[] = {
+    {"scan", SUGGEST_SCAN},
+    {"bktree", SUGGEST_BKTREE},
+    {"symspell", SUGGEST_SYMSPELL},
+    {"dawg", SUGGEST_DAWG},
+};
+
+// One misspelled query and the word it was made from
+typedef struct Query {
+    char word[MAX_WORD_LENGTH + 1];
+    const char* original;
+} Query;
+
+// xorshift64*: fixed seeds keep the data identical from run to run
+static uint64_t nextRandom(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// One to four syllables and an optional suffix. Words share prefixes and
+// suffixes the way a natural-language list does.
+static void generateWord(char* word, uint64_t* seed) {
+    static const char* onsets[] = {
+        "", "b", "c", "d", "f", "g", "h", "j", "k", "l", "m", "n", "p", "r", "s", "t", "v", "w",
+        "br", "cr", "dr", "gr", "pl", "st", "tr", "ch", "sh", "th"
+    };
+    static const char* vowels[] = {"a", "e", "i", "o", "u", "ai", "ea", "ou", "y"};
+    static const char* codas[] = {"", "", "", "n", "r", "s", "t", "l", "m", "ng", "st", "nd", "ck"};
+    static const char* suffixes[] = {"", "", "", "", "s", "ed", "ing", "er", "ly", "tion", "ness"};
+    static const int syllableWeights[] = {15, 55, 85, 100};  // Cumulative percentages
+    int roll = (int)(nextRandom(seed) % 100);
+    int syllables = 1;
+    while (roll >= syllableWeights[syllables - 1]) syllables++;
+    word[0] = '\0';
+    for (int i = 0; i < syllables; i++) {
+        strcat(word, onsets[nextRandom(seed) % (sizeof(onsets) / sizeof(onsets[0]))]);
+        strcat(word, vowels[nextRandom(seed) % (sizeof(vowels) / sizeof(vowels[0]))]);
+        strcat(word, codas[nextRandom(seed) % (sizeof(codas) / sizeof(codas[0]))]);
+    }
+    strcat(word, suffixes[nextRandom(seed) % (sizeof(suffixes) / sizeof(suffixes[0]))]);
+}
+
+// Applies random insertions, deletions and substitutions until the word is
+// exactly 'edits' away from the original and not in the dictionary
+static bool makeTypo(char* typo, const char* original, int edits, const Dictionary* dict, uint64_t* seed) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        strcpy(typo, original);
+        for (int e = 0; e < edits; e++) {
+            size_t length = strlen(typo);
+            size_t position = nextRandom(seed) % (length + 1);
+            char letter = (char)('a' + nextRandom(seed) % 26);
+            int kind = (int)(nextRandom(seed) % 3);
+            if (kind == 0 && length < MAX_WORD_LENGTH) {
+                memmove(typo + position + 1, typo + position, length - position + 1);
+                typo[position] = letter;
+            } else if (kind == 1 && position < length && length > 1) {
+                memmove(typo + position, typo + position + 1, length - position);
+            } else if (position < length) {
+                typo[position] = letter;
+            }
+        }
+        if (levenshteinDistance(typo, original) == edits && !searchWord(dict, typo)) return true;
+    }
+    return false;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Fills 'lookups' with LOOKUPS random dictionary words, or random
+// distance-1 typos of them, copied into one returned buffer so that the
+// timed lookups never read the dictionary's own pool
+static char* makeLookups(const Dictionary* dict, bool typos, const char** lookups, uint64_t* seed) {
+    size_t longest = 0;
+    for (uint32_t i = 0; i < dict->count; i++) {
+        if (dict->lengths[i] > longest) longest = dict->lengths[i];
+    }
+    char* text = malloc((size_t)LOOKUPS * (longest + 2));
+    if (!text) return NULL;
+    char* next = text;
+    char word[MAX_WORD_LENGTH + 1];
+    for (int i = 0; i < LOOKUPS; i++) {
+        const char* original;
+        do {
+            original = dictionaryWord(dict, (uint32_t)(nextRandom(seed) % dict->count));
+        } while (typos && !makeTypo(word, original, 1, dict, seed));
+        if (!typos) strcpy(word, original);
+        size_t length = strlen(word) + 1;
+        memcpy(next, word, length);
+        lookups[i] = next;
+        next += length;
+    }
+    return text;
+}
+
+// Times searchWords over 'lookups' in groups the way batch mode calls it;
+// adds the number found to 'found' and returns nanoseconds per lookup
+static double timeSearchWords(const Dictionary* dict, const char** lookups, long* found) {
+    bool results[256];
+    double start = now();
+    for (int i = 0; i < LOOKUPS; i += 256) {
+        int count = LOOKUPS - i < 256 ? LOOKUPS - i : 256;
+        searchWords(dict, lookups + i, count, results);
+        for (int j = 0; j < count; j++) *found += results[j];
+    }
+    return (now() - start) * 1e9 / LOOKUPS;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double* sorted, int count, double fraction) {
+    int rank = (int)(fraction * count + 0.999999);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+// FNV-1a over the ranked words, to compare result lists between engines
+static uint64_t hashSuggestions(const Suggestion* results, int count) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < count; i++) {
+        for (const char* c = results[i].word; ; c++) {
+            hash = (hash ^ (unsigned char)*c) * 0x100000001b3ULL;
+            if (!*c) break;
+        }
+    }
+    return hash;
+}
+
+// Writes the word list and a Zipf-distributed "word count" frequency list
+static bool writeWordFiles(const Dictionary* words, const char* wordPath, const char* frequencyPath) {
+    FILE* wordFile = fopen(wordPath, "w");
+    FILE* frequencyFile = fopen(frequencyPath, "w");
+    bool written = wordFile && frequencyFile;
+    for (uint32_t i = 0; written && i < words->count; i++) {
+        written = fprintf(wordFile, "%s\n", dictionaryWord(words, i)) > 0 &&
+            fprintf(frequencyFile, "%s %u\n", dictionaryWord(words, i), 100000000u / (i + 1)) > 0;
+    }
+    if (wordFile && fclose(wordFile) != 0) written = false;
+    if (frequencyFile && fclose(frequencyFile) != 0) written = false;
+    return written;
+}
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [-n words[,words...]] [-q queries] [-k suggestions] [-d max_distance] [-j] [engine...]\n", program);
+    printf("Engines: scan bktree symspell dawg (default: all)\n");
+    printf("-n dictionary sizes (default 10000,100000,1000000), -q queries per typo distance (default 100)\n");
+    printf("-j prints JSON lines instead of CSV\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* sizeList = "10000,100000,1000000";
+    int queryCount = 100;
+    int k = 5;
+    int maxDistance = 2;
+    int json = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:q:k:d:j")) != -1) {
+        switch (opt) {
+            case 'n':
+                sizeList = optarg;
+                break;
+            case 'q':
+                queryCount = atoi(optarg);
+                break;
+            case 'k':
+                k = atoi(optarg);
+                break;
+            case 'd':
+                maxDistance = atoi(optarg);
+                break;
+            case 'j':
+                json = 1;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (queryCount < 1) queryCount = 1;
+    if (k < 1) k = 1;
+    if (maxDistance < 0) maxDistance = 0;
+
+    char wordPath[] = "/tmp/spell_bench_words_XXXXXX";
+    char frequencyPath[] = "/tmp/spell_bench_frequencies_XXXXXX";
+    int wordFd = mkstemp(wordPath);
+    int frequencyFd = mkstemp(frequencyPath);
+    Suggestion* results = malloc(k * sizeof(Suggestion));
+    Query* queries = malloc((size_t)MAX_EDITS * queryCount * sizeof(Query));
+    uint64_t* expected = malloc((size_t)MAX_EDITS * queryCount * sizeof(uint64_t));
+    double* latencies = malloc(queryCount * sizeof(double));
+    const char** hits = malloc(LOOKUPS * sizeof(const char*));
+    const char** misses = malloc(LOOKUPS * sizeof(const char*));
+    if (wordFd < 0 || frequencyFd < 0 || !results || !queries || !expected || !latencies || !hits || !misses) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    close(wordFd);
+    close(frequencyFd);
+
+    if (!json) {
+        printf("words,engine,edits,load_ms,index_ms,bytes_per_word,hit_ns,miss_ns,fast_hit_ns,fast_miss_ns,p50_us,p90_us,p99_us,max_us,recall,agree\n");
+    }
+
+    int failures = 0;
+    const int engineCount = (int)(sizeof(engines) / sizeof(engines[0]));
+    char* sizes = strdup(sizeList);
+    for (char* size = sizes ? strtok(sizes, ",") : NULL; size; size = strtok(NULL, ",")) {
+        long wordCount = atol(size);
+        if (wordCount < 1) continue;
+
+        // The generated dictionary doubles as the source of queries
+        Dictionary words;
+        initializeDictionary(&words);
+        uint64_t seed = 0x9E3779B97F4A7C15ULL + (uint64_t)wordCount;
+        char word[MAX_WORD_LENGTH + 1];
+        while ((long)words.count < wordCount) {
+            generateWord(word, &seed);
+            insertWord(&words, word);
+        }
+        if (!writeWordFiles(&words, wordPath, frequencyPath)) {
+            fprintf(stderr, "Cannot write the generated dictionary\n");
+            failures++;
+            freeDictionary(&words);
+            break;
+        }
+        for (int e = 0; e < MAX_EDITS; e++) {
+            for (int q = 0; q < queryCount; q++) {
+                Query* query = &queries[e * queryCount + q];
+                do {
+                    query->original = dictionaryWord(&words, (uint32_t)(nextRandom(&seed) % words.count));
+                } while (!makeTypo(query->word, query->original, e + 1, &words, &seed));
+            }
+        }
+        char* hitText = makeLookups(&words, false, hits, &seed);
+        char* missText = makeLookups(&words, true, misses, &seed);
+        if (!hitText || !missText) {
+            fprintf(stderr, "Memory allocation failed\n");
+            failures++;
+            free(hitText);
+            free(missText);
+            freeDictionary(&words);
+            break;
+        }
+
+        bool first = true;
+        for (int c = 0; c < engineCount; c++) {
+            const EngineInfo* engine = &engines[c];
+            if (optind < argc) {
+                int selected = 0;
+                for (int i = optind; i < argc; i++) {
+                    if (strcmp(argv[i], engine->name) == 0) selected = 1;
+                }
+                if (!selected) continue;
+            }
+
+            Dictionary dict;
+            initializeDictionary(&dict);
+            double start = now();
+            bool loaded = loadDictionary(&dict, wordPath) == wordCount && loadFrequencies(&dict, frequencyPath) == wordCount;
+            double middle = now();
+            loaded = loaded && setSuggestEngine(&dict, engine->engine);
+            double end = now();
+            if (!loaded) {
+                fprintf(stderr, "Cannot load %ld words for %s\n", wordCount, engine->name);
+                failures++;
+                freeDictionary(&dict);
+                continue;
+            }
+            double loadTime = middle - start;
+            double indexTime = end - middle;
+            double bytesPerWord = (double)dictionaryMemory(&dict) / dict.count;
+
+            // Hits are dictionary words in random order; misses are random
+            // distance-1 typos. Both are timed again through the fast path.
+            long found = 0;
+            start = now();
+            for (int i = 0; i < LOOKUPS; i++) found += searchWord(&dict, hits[i]);
+            middle = now();
+            for (int i = 0; i < LOOKUPS; i++) found -= searchWord(&dict, misses[i]);
+            end = now();
+            double hitNs = (middle - start) * 1e9 / LOOKUPS;
+            double missNs = (end - middle) * 1e9 / LOOKUPS;
+            long fastFound = 0;
+            double fastHitNs = 0;
+            double fastMissNs = 0;
+            if (enableFastLookup(&dict, true)) {
+                fastHitNs = timeSearchWords(&dict, hits, &fastFound);
+                fastMissNs = timeSearchWords(&dict, misses, &fastFound);
+            }
+            if (found != LOOKUPS || fastFound != LOOKUPS) failures++;
+
+            for (int e = 0; e < MAX_EDITS; e++) {
+                int recalled = 0;
+                bool agree = true;
+                for (int q = 0; q < queryCount; q++) {
+                    const Query* query = &queries[e * queryCount + q];
+                    start = now();
+                    int count = topSuggestions(&dict, query->word, maxDistance, results, k);
+                    latencies[q] = (now() - start) * 1e6;
+                    if (count < 0) {
+                        agree = false;
+                        count = 0;
+                    }
+                    for (int i = 0; i < count; i++) {
+                        if (strcmp(results[i].word, query->original) == 0) recalled++;
+                    }
+                    // Every engine must rank the same words
+                    uint64_t hash = hashSuggestions(results, count);
+                    if (first) expected[e * queryCount + q] = hash;
+                    else if (expected[e * queryCount + q] != hash) agree = false;
+                }
+                if (!agree) failures++;
+                qsort(latencies, queryCount, sizeof(double), compareDoubles);
+                double recall = (double)recalled / queryCount;
+                if (json) {
+                    printf("{\"words\":%ld,\"engine\":\"%s\",\"edits\":%d,\"load_ms\":%.1f,\"index_ms\":%.1f,"
+                           "\"bytes_per_word\":%.1f,\"hit_ns\":%.1f,\"miss_ns\":%.1f,\"fast_hit_ns\":%.1f,"
+                           "\"fast_miss_ns\":%.1f,\"p50_us\":%.1f,\"p90_us\":%.1f,"
+                           "\"p99_us\":%.1f,\"max_us\":%.1f,\"recall\":%.3f,\"agree\":%s}\n",
+                           wordCount, engine->name, e + 1, loadTime * 1e3, indexTime * 1e3, bytesPerWord, hitNs,
+                           missNs, fastHitNs, fastMissNs, percentile(latencies, queryCount, 0.5), percentile(latencies, queryCount, 0.9),
+                           percentile(latencies, queryCount, 0.99), latencies[queryCount - 1], recall,
+                           agree ? "true" : "false");
+                } else {
+                    printf("%ld,%s,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.3f,%s\n", wordCount, engine->name,
+                           e + 1, loadTime * 1e3, indexTime * 1e3, bytesPerWord, hitNs, missNs, fastHitNs, fastMissNs,
+                           percentile(latencies, queryCount, 0.5), percentile(latencies, queryCount, 0.9),
+                           percentile(latencies, queryCount, 0.99), latencies[queryCount - 1], recall,
+                           agree ? "ok" : "FAIL");
+                }
+                fflush(stdout);
+            }
+            first = false;
+            freeDictionary(&dict);
+        }
+        free(hitText);
+        free(missText);
+        freeDictionary(&words);
+    }
+
+    free(sizes);
+    remove(wordPath);
+    remove(frequencyPath);
+    free(results);
+    free(queries);
+    free(expected);
+    free(latencies);
+    free(hits);
+    free(misses);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,31 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "spell_checker.h"
+
+// Files are read in chunks of this size, cut after the last non-word byte
+#define BATCH_CHUNK_SIZE (256 * 1024)
+// Longest suggestion list written per misspelling
+#define BATCH_MAX_SUGGESTIONS 16
+
+typedef struct BatchOptions {
+    int threads;            // 0 for one per CPU
+    int maxDistance;
+    int maxSuggestions;     // Best-ranked words listed, at most BATCH_MAX_SUGGESTIONS
+} BatchOptions;
+
+typedef struct BatchResult {
+    long words;             // Tokens checked
+    long misspelled;
+    int failedFiles;        // Files that could not be read; the rest are still checked
+} BatchResult;
+
+// Checks every word of the given files against the (read-only) dictionary
+// on a pool of threads. Each misspelling becomes one JSON line on 'output',
+// in file order:
+//   {"file":"a.txt","line":3,"column":7,"offset":120,"word":"teh","suggestions":["the"]}
+// Returns 0 on success, -1 if a file could not be read or output failed.
+int checkFiles(const Dictionary* dict, char* const* paths, int pathCount, const BatchOptions* options,
+               FILE* output, BatchResult* result);
+
+#endif
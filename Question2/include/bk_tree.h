@@ -0,0 +1,36 @@
+#ifndef BK_TREE_H
+#define BK_TREE_H
+
+#include "spell_checker.h"
+
+// Burkhard-Keller tree over the dictionary's words. Every child edge is
+// labelled with the edit distance between child and parent, so by the
+// triangle inequality a query at distance d from a node only has to visit
+// the children labelled d - maxDistance .. d + maxDistance.
+typedef struct BkNode {
+    uint32_t word;          // Dictionary word index
+    uint32_t firstChild;    // Node index, 0 for none (the root is never a child)
+    uint32_t nextSibling;
+    uint32_t distance;      // Edit distance to the parent
+} BkNode;
+
+typedef struct BkTree {
+    BkNode* nodes;          // nodes[0] is the root
+    uint32_t count;
+    uint32_t capacity;
+} BkTree;
+
+void initializeBkTree(BkTree* tree);
+// Adds every dictionary word not yet in the tree
+bool buildBkTree(BkTree* tree, const Dictionary* dict);
+// Returns false if out of memory; a word already in the tree is left as is
+bool bkTreeInsert(BkTree* tree, const Dictionary* dict, uint32_t word);
+// Returns false if memory ran out; the words reported so far are then
+// incomplete
+bool bkTreeSearch(const BkTree* tree, const Dictionary* dict, const char* word, int maxDistance,
+                  SuggestionCallback callback, void* context);
+size_t bkTreeMemory(const BkTree* tree);
+bool copyBkTree(BkTree* copy, const BkTree* tree);
+void freeBkTree(BkTree* tree);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef CONCURRENT_DICTIONARY_H
+#define CONCURRENT_DICTIONARY_H
+
+#include "spell_checker.h"
+
+// A dictionary that checker threads read without locks while a writer
+// adds and removes words. Readers always see a complete, immutable
+// snapshot. A writer builds the next snapshot on the side, publishes it
+// with one atomic pointer store and frees the old one once no reader can
+// still be using it (epoch-based reclamation, as in RCU).
+typedef struct ConcurrentDictionary ConcurrentDictionary;
+
+// Takes over the contents of 'initial' (left empty) as the first snapshot.
+// At most 'maxReaders' threads can register. Returns NULL if out of memory.
+ConcurrentDictionary* createConcurrentDictionary(Dictionary* initial, int maxReaders);
+// Reserves a reader slot for the calling thread. Returns the slot, or -1
+// if all are taken.
+int registerDictionaryReader(ConcurrentDictionary* shared);
+// Returns the current snapshot, valid until endDictionaryRead. Reads on
+// one slot must not nest.
+const Dictionary* beginDictionaryRead(ConcurrentDictionary* shared, int reader);
+void endDictionaryRead(ConcurrentDictionary* shared, int reader);
+// Publishes a snapshot with 'add' words added and 'remove' words removed.
+// Writers are serialised; readers are never blocked. Words already present
+// (or absent, for 'remove') are skipped. Returns 0 on success, -1 if out of
+// memory (the current snapshot then stays in place).
+int updateConcurrentDictionary(ConcurrentDictionary* shared, const char* const* add, int addCount,
+                               const char* const* remove, int removeCount);
+// Number of words in the current snapshot. Only safe for the writer or
+// between beginDictionaryRead and endDictionaryRead.
+uint32_t concurrentDictionarySize(ConcurrentDictionary* shared);
+// Must only be called once no reader is active
+void freeConcurrentDictionary(ConcurrentDictionary* shared);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef DAWG_H
+#define DAWG_H
+
+#include "spell_checker.h"
+
+// Edges are 8 bytes, which limits the automaton to 2^24 nodes
+#define DAWG_MAX_NODES (1u << 24)
+
+// Minimal acyclic automaton (DAWG) over the dictionary's words: a trie in
+// which equal suffix subtrees are stored once, so words share prefixes and
+// suffixes. Each edge also counts the words that sort before it, which
+// numbers the words by their alphabetical rank while walking a path;
+// sortedWords maps that rank back to the dictionary index.
+typedef struct DawgEdge {
+    uint32_t target : 24;   // Node index
+    uint32_t label : 8;
+    uint32_t skip;          // Words of the source node that sort before this edge
+} DawgEdge;
+
+typedef struct Dawg {
+    uint32_t* firstEdge;    // Edges of node n are [firstEdge[n], firstEdge[n + 1])
+    uint8_t* final;         // Node ends a word
+    DawgEdge* edges;        // Sorted by label within a node
+    uint32_t nodeCount;
+    uint32_t edgeCount;
+    uint32_t root;
+    uint32_t* sortedWords;  // Dictionary index of the word with each rank
+    uint32_t wordCount;     // Words [0, wordCount) of the dictionary are included
+} Dawg;
+
+void initializeDawg(Dawg* dawg);
+bool buildDawg(Dawg* dawg, const Dictionary* dict);
+// Dictionary index of 'word', or -1 if it is not in the automaton
+long dawgLookup(const Dawg* dawg, const char* word);
+// Walks the automaton with one edit-distance row per depth, leaving every
+// branch whose row minimum exceeds maxDistance. Returns false, before
+// reporting any word, if memory ran out.
+bool dawgSearch(const Dawg* dawg, const Dictionary* dict, const char* word, int maxDistance,
+                SuggestionCallback callback, void* context);
+// Bytes used by the automaton, without sortedWords
+size_t dawgMemory(const Dawg* dawg);
+bool copyDawg(Dawg* copy, const Dawg* dawg);
+void freeDawg(Dawg* dawg);
+
+#endif
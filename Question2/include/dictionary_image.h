@@ -0,0 +1,55 @@
+#ifndef DICTIONARY_IMAGE_H
+#define DICTIONARY_IMAGE_H
+
+#include "spell_checker.h"
+
+// Compiled dictionary: the string pool, word frequencies, the hash table,
+// the BK-tree and the SymSpell index laid out as arrays in one file, so
+// that loading is a single mmap. Processes mapping the same image share
+// its pages.
+#define DICTIONARY_IMAGE_MAGIC   "SPDI"
+#define DICTIONARY_IMAGE_VERSION 2
+
+// Arrays are stored in native byte order, each starting on an 8-byte
+// boundary at the given file offset
+typedef struct DictionaryImageHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t headerSize;        // sizeof(DictionaryImageHeader), rejects other layouts
+    uint32_t count;
+    uint64_t poolSize;
+    uint32_t slotCount;
+    uint32_t bkNodeCount;
+    uint32_t symSpellHashCount;
+    uint32_t symSpellPostingCount;
+    uint32_t symSpellDirectoryBits;
+    uint32_t symSpellWordCount;
+    uint32_t hasFrequencies;
+    uint64_t poolOffset;
+    uint64_t offsetsOffset;
+    uint64_t lengthsOffset;
+    uint64_t frequenciesOffset;
+    uint64_t slotsOffset;
+    uint64_t bkNodesOffset;
+    uint64_t hashesOffset;
+    uint64_t startsOffset;
+    uint64_t postingsOffset;
+    uint64_t directoryOffset;
+    uint64_t fileSize;
+} DictionaryImageHeader;
+
+// Builds both suggestion indexes if needed and writes the image. Returns 0
+// on success, -1 on failure.
+int writeDictionaryImage(Dictionary* dict, const char* path);
+// Maps an image into an empty dictionary. Returns the number of words, or
+// -1 if the file cannot be mapped or is not a valid image.
+int mapDictionaryImage(Dictionary* dict, const char* path);
+// Copies a mapped dictionary to the heap so that it can be modified
+bool detachDictionaryImage(Dictionary* dict);
+// Whether 'data' points into the mapping of 'dict'. An index built after
+// mapping (the image had no section for it) lives on the heap instead.
+bool inDictionaryImage(const Dictionary* dict, const void* data);
+// Releases the mapping; the arrays pointing into it must not be freed
+void unmapDictionaryImage(Dictionary* dict);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "spell_checker.h"
+
+// Longest request line; longer lines get an error and close the connection
+#define SERVER_MAX_LINE (64 * 1024)
+// Unsent responses per client above which its requests are no longer read
+#define SERVER_MAX_PENDING (1024 * 1024)
+// Longest suggestion list per SUGGEST response
+#define SERVER_MAX_SUGGESTIONS 16
+
+typedef struct ServerOptions {
+    int maxDistance;
+    int maxSuggestions;     // Default for SUGGEST, at most SERVER_MAX_SUGGESTIONS
+} ServerOptions;
+
+// Serves the dictionary on a Unix domain socket until SIGINT or SIGTERM.
+// A socket file left behind by a daemon that is gone is replaced.
+// One thread runs a poll() loop over all clients; ADD and REMOVE run on a
+// writer thread, and the loop keeps answering from the current snapshot
+// meanwhile. Requests are lines; clients may pipeline any number of them,
+// and responses (one line each) come back in request order:
+//   CHECK word          FOUND word | MISSING word
+//   SUGGEST word [k]    SUGGESTIONS word [suggestion...]
+//   ADD word...         OK count
+//   REMOVE word...      OK count
+//   SIZE                SIZE count
+//   QUIT                (closes the connection after the pending responses)
+// Anything else is answered with "ERROR reason". Takes over the contents
+// of 'dict' (left empty). Returns 0 after a signal, -1 if the socket could
+// not be set up.
+int runServer(Dictionary* dict, const char* socketPath, const ServerOptions* options);
+
+#endif
@@ -5,20 +5,130 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
-// Define the structure for a BST node
-typedef struct TreeNode {
-    char word[256];
-    struct TreeNode* left;
-    struct TreeNode* right;
-} TreeNode;
+// Longest word stored; longer tokens are skipped when loading
+#define MAX_WORD_LENGTH 255
+// Suggestions listed by suggestWords
+#define MAX_SUGGESTIONS 10
+
+// One slot of the open-addressing hash table. 'word' is the word index
+// plus one, so a zeroed slot is empty; the stored hash avoids touching the
+// string pool for most mismatches.
+typedef struct HashSlot {
+    uint32_t hash;
+    uint32_t word;
+} HashSlot;
+
+// A ranked suggestion: closer words first, then more frequent ones
+typedef struct Suggestion {
+    const char* word;
+    int distance;
+    uint32_t frequency;
+} Suggestion;
+
+// Receives each suggestion with its edit distance from the query
+typedef void (*SuggestionCallback)(const char* word, int distance, void* context);
+
+// How suggestions are found
+typedef enum SuggestEngine {
+    SUGGEST_SCAN,       // Compare the query with every word
+    SUGGEST_BKTREE,     // Prune by edit distance with a BK-tree (bk_tree.h)
+    SUGGEST_SYMSPELL,   // Look up shared deletions (symspell.h)
+    SUGGEST_DAWG        // Walk a minimal word automaton (dawg.h)
+} SuggestEngine;
+
+struct BkTree;
+struct SymSpellIndex;
+struct Dawg;
+struct WordTable;
+
+// The dictionary keeps every word once, NUL-terminated, in one string
+// pool. Words are addressed by index; the hash table maps a word to its
+// index with linear probing and is kept at most half full. A word taken
+// out by removeWord leaves the hash table but keeps its index, and its
+// place in the suggestion indexes, until the dictionary is rebuilt;
+// searches skip it.
+typedef struct Dictionary {
+    char* pool;
+    size_t poolSize;
+    size_t poolCapacity;
+    uint32_t* offsets;      // Start of each word in the pool
+    uint8_t* lengths;
+    uint32_t* frequencies;  // Optional counts from loadFrequencies, NULL if none
+    uint32_t count;
+    uint32_t capacity;
+    HashSlot* slots;
+    uint32_t slotCount;     // Power of two
+    SuggestEngine engine;
+    struct BkTree* bkTree;  // Built by setSuggestEngine, then kept up to date by insertWord
+    struct SymSpellIndex* symSpell; // Built by setSuggestEngine; later words are scanned
+    struct Dawg* dawg;      // Likewise
+    struct WordTable* wordTable; // Exact-lookup fast path, kept up to date by insertWord
+    uint64_t* removed;      // Bitmap of the indices taken out by removeWord, NULL if none
+    uint32_t removedCount;
+    const void* image;      // Mapped dictionary image backing the arrays, or NULL
+    size_t imageSize;
+} Dictionary;
 
 // Function prototypes
-void initializeTree(TreeNode** root);
-void insertWord(TreeNode** root, const char* word);
-bool searchWord(const TreeNode* root, const char* word);
-void suggestWords(const TreeNode* root, const char* word, int maxDistance);
-void freeTree(TreeNode* root);
+void initializeDictionary(Dictionary* dict);
+// Adds a word; returns false for duplicates and words that cannot be stored
+bool insertWord(Dictionary* dict, const char* word);
+bool searchWord(const Dictionary* dict, const char* word);
+// Takes a word out without moving any other word. Returns 1 if it was
+// removed, 0 if it was not in the dictionary, -1 if out of memory.
+int removeWord(Dictionary* dict, const char* word);
+// Builds the exact-lookup fast path (word_table.h): words of up to 28 bytes
+// in padded 32-byte slots, hashed with CRC32C and compared with SIMD where
+// the CPU allows, optionally behind a Bloom prefilter. Returns false if out
+// of memory; lookups then keep using the hash table.
+bool enableFastLookup(Dictionary* dict, bool prefilter);
+// searchWord for many words; with the fast path enabled, short words are
+// looked up in groups whose cache misses overlap
+void searchWords(const Dictionary* dict, const char* const* words, int count, bool* found);
+// Loads a whitespace-separated word list, or maps a compiled dictionary
+// image (dictionary_image.h). Returns the number of words read, or -1 if
+// the file cannot be read.
+int loadDictionary(Dictionary* dict, const char* path);
+// Reads "word count" pairs and records each count; words not yet in the
+// dictionary are added. Returns the number of pairs read, or -1 if the
+// file cannot be read.
+int loadFrequencies(Dictionary* dict, const char* path);
+// Selects the suggestion engine, building its index if needed. Returns
+// false if the index could not be built; the engine is then unchanged.
+bool setSuggestEngine(Dictionary* dict, SuggestEngine engine);
+// Calls 'callback' for every word within 'maxDistance' edits of 'word'.
+// Returns false if memory ran out; the words reported so far are then
+// incomplete.
+bool findSuggestions(const Dictionary* dict, const char* word, int maxDistance,
+                     SuggestionCallback callback, void* context);
+// Fills 'results' with the best 'k' words within maxDistance, ranked by
+// distance and then by frequency, and returns how many were found. Closer
+// distances are searched first, and the search stops once k words are
+// known that no farther word could outrank. Returns -1 if memory ran out.
+int topSuggestions(const Dictionary* dict, const char* word, int maxDistance, Suggestion* results, int k);
+// Prints the best MAX_SUGGESTIONS suggestions
+void suggestWords(const Dictionary* dict, const char* word, int maxDistance);
+// Deep copy, suggestion indexes included. The copy is always on the heap,
+// also when 'dict' is a mapped image.
+bool copyDictionary(Dictionary* copy, const Dictionary* dict);
+void freeDictionary(Dictionary* dict);
+// Bytes held by the words, the hash table and every suggestion index built
+// so far (mapped from an image or allocated)
+size_t dictionaryMemory(const Dictionary* dict);
 int levenshteinDistance(const char* str1, const char* str2);
+// Edit distance if it is at most maxDistance, otherwise maxDistance + 1.
+// Exits as soon as the bound cannot be met; words of up to 64 characters
+// use a bit-parallel kernel.
+int boundedLevenshteinDistance(const char* str1, size_t len1, const char* str2, size_t len2, int maxDistance);
+
+static inline const char* dictionaryWord(const Dictionary* dict, uint32_t index) {
+    return dict->pool + dict->offsets[index];
+}
+
+static inline bool wordRemoved(const Dictionary* dict, uint32_t index) {
+    return dict->removed && (dict->removed[index / 64] >> (index % 64) & 1);
+}
 
 #endif
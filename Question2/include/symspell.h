@@ -0,0 +1,37 @@
+#ifndef SYMSPELL_H
+#define SYMSPELL_H
+
+#include "spell_checker.h"
+
+// Symmetric-delete index (SymSpell). Every string obtained by deleting up
+// to SYMSPELL_MAX_DISTANCE characters from a word's first
+// SYMSPELL_PREFIX_LENGTH characters is hashed and mapped to that word. A
+// query generates the same deletions of its own prefix; any word sharing
+// one of them is a candidate and is verified with the edit distance.
+#define SYMSPELL_MAX_DISTANCE   2
+#define SYMSPELL_PREFIX_LENGTH  7
+
+// Deletion hashes are kept sorted and unique. postings[starts[i] ..
+// starts[i + 1]) are the words behind hashes[i]; a directory on the top
+// hash bits narrows each lookup to a few entries.
+typedef struct SymSpellIndex {
+    uint64_t* hashes;
+    uint32_t* starts;       // hashCount + 1 entries
+    uint32_t* postings;     // Word indices
+    uint32_t hashCount;
+    uint32_t* directory;    // (1 << directoryBits) + 1 entries into 'hashes'
+    int directoryBits;
+    uint32_t wordCount;     // Words [0, wordCount) of the dictionary are indexed
+} SymSpellIndex;
+
+void initializeSymSpell(SymSpellIndex* index);
+bool buildSymSpell(SymSpellIndex* index, const Dictionary* dict);
+// Reports indexed words within maxDistance (at most SYMSPELL_MAX_DISTANCE).
+// Returns false, before reporting any word, if memory ran out.
+bool symSpellSearch(const SymSpellIndex* index, const Dictionary* dict, const char* word, int maxDistance,
+                    SuggestionCallback callback, void* context);
+size_t symSpellMemory(const SymSpellIndex* index);
+bool copySymSpell(SymSpellIndex* copy, const SymSpellIndex* index);
+void freeSymSpell(SymSpellIndex* index);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <stddef.h>
+
+// Task callback: process item 'index' of the current job. Returns 0 on
+// success, non-zero to mark the whole job as failed.
+typedef int (*PoolTask)(void* context, size_t index);
+
+typedef struct ThreadPool ThreadPool;
+
+// Creates a pool that runs jobs on 'threads' threads in total; the thread
+// calling runThreadPool is one of them, so 'threads - 1' workers are spawned.
+ThreadPool* createThreadPool(int threads);
+int runThreadPool(ThreadPool* pool, size_t count, PoolTask task, void* context);
+void freeThreadPool(ThreadPool* pool);
+int defaultThreadCount(void);
+
+#endif
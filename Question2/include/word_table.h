@@ -0,0 +1,58 @@
+#ifndef WORD_TABLE_H
+#define WORD_TABLE_H
+
+#include "spell_checker.h"
+
+// Longest word kept in a slot; longer words use the dictionary's own table
+#define WORD_TABLE_TEXT 28
+// Most words per wordTableLookupBatch call
+#define WORD_TABLE_BATCH 16
+
+// One 32-byte slot: the word itself, zero-padded, so that a probe is one
+// aligned load and a 16- or 32-byte compare without touching the string pool
+typedef struct WordSlot {
+    _Alignas(32) char text[WORD_TABLE_TEXT];
+    uint32_t word;          // Dictionary index plus one, 0 if empty
+} WordSlot;
+
+// Lookup kernels, picked once per table from the CPU's features
+typedef enum WordKernel {
+    WORD_KERNEL_PORTABLE,   // Multiplicative hash, memcmp
+    WORD_KERNEL_SSE42,      // CRC32C hash, two 16-byte SSE2 compares
+    WORD_KERNEL_AVX2        // CRC32C hash, one 32-byte compare
+} WordKernel;
+
+// Exact-membership table over the words of at most WORD_TABLE_TEXT bytes:
+// open addressing with linear probing, at most 3/4 full. The optional
+// prefilter is a blocked Bloom filter (6 bits set in one 64-byte block per
+// word, 8 bits per slot) that rejects most unknown words with a single
+// cache line read, in an array 1/32 the size of the slots.
+typedef struct WordTable {
+    WordSlot* slots;
+    uint32_t slotCount;     // Power of two
+    uint32_t count;
+    uint64_t* bloom;        // 8 words per block, NULL without a prefilter
+    uint32_t bloomBlocks;   // Power of two
+    WordKernel kernel;
+} WordTable;
+
+void initializeWordTable(WordTable* table);
+// Indexes every short word of the dictionary. Returns false if out of memory.
+bool buildWordTable(WordTable* table, const Dictionary* dict, bool prefilter);
+// Adds a word (length at most WORD_TABLE_TEXT) known not to be present
+bool wordTableInsert(WordTable* table, const char* word, size_t length, uint32_t index);
+// Takes a word out; returns false if it was not present. Its prefilter
+// bits stay set, which only lets a few more misses through to a probe.
+bool wordTableRemove(WordTable* table, const char* word, size_t length);
+// Dictionary index of a word of 1 to WORD_TABLE_TEXT bytes, or -1
+long wordTableLookup(const WordTable* table, const char* word, size_t length);
+// Looks up to WORD_TABLE_BATCH such words at once: every word is hashed and
+// its slot prefetched before the first probe, so the cache misses overlap
+// instead of being paid one after another
+void wordTableLookupBatch(const WordTable* table, const char* const* words, const size_t* lengths, int count,
+                          long* results);
+size_t wordTableMemory(const WordTable* table);
+bool copyWordTable(WordTable* copy, const WordTable* table);
+void freeWordTable(WordTable* table);
+
+#endif
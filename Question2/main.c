@@ -1,42 +1,143 @@
+#include <unistd.h>
 #include "spell_checker.h"
+#include "batch.h"
+#include "dictionary_image.h"
+#include "server.h"
 
-int main() {
-    TreeNode* root = NULL;
-    initializeTree(&root);
+static void printUsage(const char* program) {
+    printf("Usage: %s [-d dictionary_file] [-f frequency_file] [-e scan|bktree|symspell|dawg] [-t threads] [-o output] [file...]\n", program);
+    printf("       %s [-d dictionary_file] [-f frequency_file] -w image_file\n", program);
+    printf("       %s [-d dictionary_file] [-f frequency_file] [-e engine] -s socket_path\n", program);
+    printf("With files, every word in them is checked and misspellings are written as JSON lines.\n");
+    printf("-w compiles the dictionary and its indexes into an image that -d can load instantly.\n");
+    printf("-s serves CHECK, SUGGEST, ADD and REMOVE requests on a Unix domain socket until interrupted.\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* dictionaryFile = "dictionary.txt";
+    const char* outputFile = NULL;
+    const char* imageFile = NULL;
+    const char* frequencyFile = NULL;
+    const char* socketPath = NULL;
+    SuggestEngine engine = SUGGEST_BKTREE;
+    BatchOptions batch = { 0, 2, 5 };
+    int opt;
+    while ((opt = getopt(argc, argv, "d:f:e:t:o:w:s:")) != -1) {
+        switch (opt) {
+            case 'd':
+                dictionaryFile = optarg;
+                break;
+            case 'f':
+                frequencyFile = optarg;
+                break;
+            case 'e':
+                if (strcmp(optarg, "scan") == 0) engine = SUGGEST_SCAN;
+                else if (strcmp(optarg, "bktree") == 0) engine = SUGGEST_BKTREE;
+                else if (strcmp(optarg, "symspell") == 0) engine = SUGGEST_SYMSPELL;
+                else if (strcmp(optarg, "dawg") == 0) engine = SUGGEST_DAWG;
+                else {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 't':
+                batch.threads = atoi(optarg);
+                break;
+            case 'o':
+                outputFile = optarg;
+                break;
+            case 'w':
+                imageFile = optarg;
+                break;
+            case 's':
+                socketPath = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    Dictionary dict;
+    initializeDictionary(&dict);
 
     // Load dictionary file
-    FILE* dictFile = fopen("dictionary.txt", "r");
-    if (dictFile == NULL) {
+    if (loadDictionary(&dict, dictionaryFile) < 0) {
         printf("Error: Dictionary file not found.\n");
         return 1;
     }
+    if (frequencyFile && loadFrequencies(&dict, frequencyFile) < 0) {
+        printf("Error: Frequency file not found.\n");
+        freeDictionary(&dict);
+        return 1;
+    }
+    if (imageFile) {
+        int status = writeDictionaryImage(&dict, imageFile);
+        if (status != 0) printf("Error: Cannot write dictionary image.\n");
+        else printf("Wrote %u words to %s.\n", dict.count, imageFile);
+        freeDictionary(&dict);
+        return status == 0 ? 0 : 1;
+    }
+    if (!setSuggestEngine(&dict, engine)) {
+        printf("Error: Not enough memory for the suggestion index.\n");
+        freeDictionary(&dict);
+        return 1;
+    }
+    if (!enableFastLookup(&dict, true)) {
+        printf("Error: Not enough memory for the lookup table.\n");
+        freeDictionary(&dict);
+        return 1;
+    }
 
-    char word[256];
-    while (fscanf(dictFile, "%s", word) != EOF) {
-        insertWord(&root, word);
+    // Daemon mode: serve requests until SIGINT or SIGTERM
+    if (socketPath) {
+        ServerOptions server = { batch.maxDistance, batch.maxSuggestions };
+        int status = runServer(&dict, socketPath, &server);
+        if (status != 0) printf("Error: Cannot listen on %s.\n", socketPath);
+        freeDictionary(&dict);
+        return status == 0 ? 0 : 1;
     }
-    fclose(dictFile);
+
+    // Batch mode: check the given files and exit
+    if (optind < argc) {
+        FILE* output = outputFile ? fopen(outputFile, "w") : stdout;
+        if (!output) {
+            printf("Error: Cannot open output file.\n");
+            freeDictionary(&dict);
+            return 1;
+        }
+        BatchResult result;
+        int status = checkFiles(&dict, argv + optind, argc - optind, &batch, output, &result);
+        if (output != stdout) fclose(output);
+        fprintf(stderr, "Checked %ld words, %ld misspelled.\n", result.words, result.misspelled);
+        freeDictionary(&dict);
+        return status == 0 ? 0 : 1;
+    }
+
+    char word[MAX_WORD_LENGTH + 1];
 
     printf("Spell Checker Tool\n");
     printf("==================\n");
 
     while (1) {
         printf("\nEnter a word (or 'exit' to quit): ");
-        scanf("%s", word);
+        if (scanf("%255s", word) != 1) {
+            break;
+        }
 
         if (strcmp(word, "exit") == 0) {
             break;
         }
 
-        if (searchWord(root, word)) {
+        if (searchWord(&dict, word)) {
             printf("Word found.\n");
         } else {
             printf("Word not found.\n");
             printf("Suggestions:\n");
-            suggestWords(root, word, 2); // Suggest words with edit distance ≤ 2
+            suggestWords(&dict, word, 2); // Suggest words with edit distance ≤ 2
         }
     }
 
-    freeTree(root);
+    freeDictionary(&dict);
     return 0;
 }
@@ -0,0 +1,368 @@
+#include "batch.h"
+#include "thread_pool.h"
+#include <ctype.h>
+#include <stdarg.h>
+
+// Chunks handed to the pool at once, per thread
+#define CHUNKS_PER_THREAD 4
+// Tokens looked up together, so that their cache misses overlap
+#define TOKENS_PER_LOOKUP 16
+
+// One slice of a file, checked by one task
+typedef struct Chunk {
+    const char* path;       // JSON-escaped file name
+    char* text;
+    size_t length;
+    long long offset;       // Of text[0] in the file
+    long line;              // Of text[0], 1-based
+    long column;
+    bool continuesToken;    // text starts inside an over-long token
+    char* output;           // JSON lines for this chunk
+    size_t outputSize;
+    size_t outputCapacity;
+    long words;
+    long misspelled;
+    int failed;
+} Chunk;
+
+// Streams one file into chunks. A token cut by the chunk boundary is
+// carried over to the next chunk.
+typedef struct Reader {
+    FILE* file;
+    const char* path;
+    char carry[MAX_WORD_LENGTH];
+    size_t carryLength;
+    bool continuesToken;
+    long long offset;
+    long line;
+    long column;
+} Reader;
+
+// A token waiting for its lookup
+typedef struct Token {
+    char word[MAX_WORD_LENGTH + 1];
+    size_t length;
+    size_t position;
+    long line;
+    long column;
+} Token;
+
+typedef struct BatchJob {
+    const Dictionary* dict;
+    const BatchOptions* options;
+    Chunk* chunks;
+} BatchJob;
+
+// Letters and apostrophes make words; digits and non-ASCII bytes are kept
+// in the token so that it can be skipped as a whole
+static bool isWordByte(unsigned char c) {
+    return isalnum(c) || c == '\'' || c >= 0x80;
+}
+
+// Writes 'text' as the body of a JSON string; 'out' needs 6 bytes per
+// input byte. Returns the end of the output.
+static char* escapeJson(char* out, const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = (char)c;
+        } else if (c < 0x20) {
+            out += sprintf(out, "\\u%04x", c);
+        } else {
+            *out++ = (char)c;
+        }
+    }
+    return out;
+}
+
+static char* escapePath(const char* path) {
+    size_t length = strlen(path);
+    char* escaped = malloc(6 * length + 1);
+    if (!escaped) return NULL;
+    *escapeJson(escaped, path, length) = '\0';
+    return escaped;
+}
+
+// Room for 'bytes' more output bytes plus a terminator
+static bool reserveOutput(Chunk* chunk, size_t bytes) {
+    if (chunk->failed) return false;
+    if (chunk->outputSize + bytes < chunk->outputCapacity) return true;
+    size_t capacity = chunk->outputCapacity ? chunk->outputCapacity : 4096;
+    while (capacity <= chunk->outputSize + bytes) capacity *= 2;
+    char* grown = realloc(chunk->output, capacity);
+    if (!grown) {
+        chunk->failed = 1;
+        return false;
+    }
+    chunk->output = grown;
+    chunk->outputCapacity = capacity;
+    return true;
+}
+
+static void appendOutput(Chunk* chunk, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0 || !reserveOutput(chunk, (size_t)needed)) return;
+    va_start(args, format);
+    vsnprintf(chunk->output + chunk->outputSize, chunk->outputCapacity - chunk->outputSize, format, args);
+    va_end(args);
+    chunk->outputSize += needed;
+}
+
+// Appends a quoted JSON string
+static void appendString(Chunk* chunk, const char* text, size_t length) {
+    if (!reserveOutput(chunk, 6 * length + 2)) return;
+    char* out = chunk->output + chunk->outputSize;
+    *out++ = '"';
+    out = escapeJson(out, text, length);
+    *out++ = '"';
+    chunk->outputSize = out - chunk->output;
+}
+
+// Checks one token not found as written; 'word' is NUL-terminated
+static void checkToken(const BatchJob* job, Chunk* chunk, char* word, size_t length, size_t position,
+                       long line, long column) {
+    // Capitalised words are also accepted in lower case
+    bool lowered = false;
+    for (size_t i = 0; i < length; i++) {
+        if (isupper((unsigned char)word[i])) {
+            word[i] = (char)tolower((unsigned char)word[i]);
+            lowered = true;
+        }
+    }
+    if (lowered && searchWord(job->dict, word)) return;
+
+    chunk->misspelled++;
+    Suggestion suggestions[BATCH_MAX_SUGGESTIONS];
+    int k = job->options->maxSuggestions < BATCH_MAX_SUGGESTIONS ? job->options->maxSuggestions : BATCH_MAX_SUGGESTIONS;
+    int count = topSuggestions(job->dict, word, job->options->maxDistance, suggestions, k);
+    if (count < 0) {
+        chunk->failed = 1;
+        return;
+    }
+
+    // Report the word as written in the document
+    appendOutput(chunk, "{\"file\":\"%s\",\"line\":%ld,\"column\":%ld,\"offset\":%lld,\"word\":\"%.*s\",\"suggestions\":[",
+                 chunk->path, line, column, chunk->offset + (long long)position, (int)length, chunk->text + position);
+    for (int i = 0; i < count; i++) {
+        if (i) appendOutput(chunk, ",");
+        appendString(chunk, suggestions[i].word, strlen(suggestions[i].word));
+    }
+    appendOutput(chunk, "]}\n");
+}
+
+// Looks the pending tokens up in one searchWords call, then checks the
+// unknown ones in document order
+static void checkTokens(const BatchJob* job, Chunk* chunk, Token* tokens, int count) {
+    const char* words[TOKENS_PER_LOOKUP] = { NULL };
+    bool found[TOKENS_PER_LOOKUP];
+    for (int i = 0; i < count; i++) words[i] = tokens[i].word;
+    searchWords(job->dict, words, count, found);
+    chunk->words += count;
+    for (int i = 0; i < count; i++) {
+        if (!found[i]) {
+            checkToken(job, chunk, tokens[i].word, tokens[i].length, tokens[i].position, tokens[i].line,
+                       tokens[i].column);
+        }
+    }
+}
+
+static int checkChunk(void* context, size_t index) {
+    const BatchJob* job = (const BatchJob*)context;
+    Chunk* chunk = &job->chunks[index];
+    const unsigned char* text = (const unsigned char*)chunk->text;
+    Token tokens[TOKENS_PER_LOOKUP];
+    int pending = 0;
+    long line = chunk->line;
+    size_t lineStart = 0;       // Position of column 1 in this chunk
+    long firstColumn = chunk->column;
+
+    size_t i = 0;
+    if (chunk->continuesToken) {
+        while (i < chunk->length && isWordByte(text[i])) i++;
+    }
+    while (i < chunk->length) {
+        if (!isWordByte(text[i])) {
+            if (text[i] == '\n') {
+                line++;
+                lineStart = i + 1;
+                firstColumn = 1;
+            }
+            i++;
+            continue;
+        }
+        size_t start = i;
+        bool plain = true;
+        while (i < chunk->length && isWordByte(text[i])) {
+            if (!isalpha(text[i]) && text[i] != '\'') plain = false;
+            i++;
+        }
+        // Quotes around a word are not part of it
+        size_t wordStart = start;
+        size_t wordEnd = i;
+        while (wordStart < wordEnd && text[wordStart] == '\'') wordStart++;
+        while (wordEnd > wordStart && text[wordEnd - 1] == '\'') wordEnd--;
+        size_t length = wordEnd - wordStart;
+        if (!plain || length == 0 || length > MAX_WORD_LENGTH) continue;
+
+        Token* token = &tokens[pending++];
+        memcpy(token->word, text + wordStart, length);
+        token->word[length] = '\0';
+        token->length = length;
+        token->position = wordStart;
+        token->line = line;
+        token->column = firstColumn + (long)(wordStart - lineStart);
+        if (pending == TOKENS_PER_LOOKUP) {
+            checkTokens(job, chunk, tokens, pending);
+            pending = 0;
+        }
+    }
+    if (pending > 0) checkTokens(job, chunk, tokens, pending);
+    return chunk->failed ? -1 : 0;
+}
+
+// Fills 'chunk' with the next slice of the reader's file. Returns the
+// number of bytes, 0 at end of file or -1 on a read error.
+static long readChunk(Reader* reader, Chunk* chunk) {
+    memcpy(chunk->text, reader->carry, reader->carryLength);
+    size_t length = reader->carryLength;
+    size_t got = fread(chunk->text + length, 1, BATCH_CHUNK_SIZE, reader->file);
+    if (ferror(reader->file)) return -1;
+    length += got;
+
+    chunk->path = reader->path;
+    chunk->offset = reader->offset;
+    chunk->line = reader->line;
+    chunk->column = reader->column;
+    chunk->continuesToken = reader->continuesToken;
+    chunk->outputSize = 0;
+    chunk->words = 0;
+    chunk->misspelled = 0;
+    chunk->failed = 0;
+
+    reader->carryLength = 0;
+    reader->continuesToken = false;
+    if (got == BATCH_CHUNK_SIZE) {
+        // Keep a trailing partial token for the next chunk
+        size_t cut = length;
+        while (cut > 0 && isWordByte((unsigned char)chunk->text[cut - 1])) cut--;
+        if (length - cut <= MAX_WORD_LENGTH) {
+            reader->carryLength = length - cut;
+            memcpy(reader->carry, chunk->text + cut, reader->carryLength);
+            length = cut;
+        } else {
+            // Too long to be a word anyway; the next chunk skips the rest of it
+            reader->continuesToken = true;
+        }
+    }
+    chunk->length = length;
+
+    // Position of the next chunk
+    reader->offset += (long long)length;
+    const char* end = chunk->text + length;
+    const char* p = chunk->text;
+    const char* lastNewline = NULL;
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+        reader->line++;
+        lastNewline = p++;
+    }
+    if (lastNewline) reader->column = 1 + (long)(end - lastNewline - 1);
+    else reader->column += (long)length;
+    return (long)length;
+}
+
+// Opens the next readable file; false when none are left
+static bool openNextFile(Reader* reader, char* const* paths, char** escapedPaths, int pathCount,
+                         int* nextPath, BatchResult* result) {
+    while (*nextPath < pathCount) {
+        int index = (*nextPath)++;
+        reader->file = fopen(paths[index], "rb");
+        if (!reader->file) {
+            fprintf(stderr, "Error: Cannot open %s.\n", paths[index]);
+            result->failedFiles++;
+            continue;
+        }
+        reader->path = escapedPaths[index];
+        reader->carryLength = 0;
+        reader->continuesToken = false;
+        reader->offset = 0;
+        reader->line = 1;
+        reader->column = 1;
+        return true;
+    }
+    return false;
+}
+
+int checkFiles(const Dictionary* dict, char* const* paths, int pathCount, const BatchOptions* options,
+               FILE* output, BatchResult* result) {
+    result->words = 0;
+    result->misspelled = 0;
+    result->failedFiles = 0;
+
+    int threads = options->threads > 0 ? options->threads : defaultThreadCount();
+    int chunkCount = threads * CHUNKS_PER_THREAD;
+    Chunk* chunks = calloc(chunkCount, sizeof(Chunk));
+    char** escapedPaths = calloc(pathCount ? pathCount : 1, sizeof(char*));
+    ThreadPool* pool = createThreadPool(threads);
+    int status = 0;
+    if (!chunks || !escapedPaths || !pool) status = -1;
+    for (int i = 0; i < chunkCount && status == 0; i++) {
+        chunks[i].text = malloc(BATCH_CHUNK_SIZE + MAX_WORD_LENGTH);
+        if (!chunks[i].text) status = -1;
+    }
+    for (int i = 0; i < pathCount && status == 0; i++) {
+        escapedPaths[i] = escapePath(paths[i]);
+        if (!escapedPaths[i]) status = -1;
+    }
+
+    BatchJob job = { dict, options, chunks };
+    Reader reader;
+    int nextPath = 0;
+    bool reading = status == 0 && openNextFile(&reader, paths, escapedPaths, pathCount, &nextPath, result);
+    while (reading) {
+        // Read a round of chunks, possibly from several files
+        int filled = 0;
+        while (reading && filled < chunkCount) {
+            long length = readChunk(&reader, &chunks[filled]);
+            if (length < 0) {
+                fprintf(stderr, "Error: Cannot read %s.\n", reader.path);
+                result->failedFiles++;
+            }
+            if (length > 0) filled++;
+            if (length <= 0) {
+                fclose(reader.file);
+                reading = openNextFile(&reader, paths, escapedPaths, pathCount, &nextPath, result);
+            }
+        }
+        if (filled == 0) break;
+
+        if (runThreadPool(pool, filled, checkChunk, &job) != 0) {
+            fprintf(stderr, "Error: Not enough memory to check the batch.\n");
+            status = -1;
+        }
+        // Results go out in document order
+        for (int i = 0; i < filled; i++) {
+            result->words += chunks[i].words;
+            result->misspelled += chunks[i].misspelled;
+            if (chunks[i].outputSize && fwrite(chunks[i].output, 1, chunks[i].outputSize, output) != chunks[i].outputSize) status = -1;
+        }
+        if (status != 0) {
+            if (reading) fclose(reader.file);
+            break;
+        }
+    }
+    if (result->failedFiles > 0) status = -1;
+
+    for (int i = 0; chunks && i < chunkCount; i++) {
+        free(chunks[i].text);
+        free(chunks[i].output);
+    }
+    for (int i = 0; escapedPaths && i < pathCount; i++) free(escapedPaths[i]);
+    free(chunks);
+    free(escapedPaths);
+    freeThreadPool(pool);
+    return status;
+}
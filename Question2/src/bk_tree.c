@@ -0,0 +1,135 @@
+#include "bk_tree.h"
+#include <limits.h>
+
+void initializeBkTree(BkTree* tree) {
+    tree->nodes = NULL;
+    tree->count = 0;
+    tree->capacity = 0;
+}
+
+static uint32_t addNode(BkTree* tree, uint32_t word, uint32_t distance) {
+    if (tree->count == tree->capacity) {
+        uint32_t capacity = tree->capacity ? tree->capacity * 2 : 1024;
+        BkNode* nodes = realloc(tree->nodes, capacity * sizeof(BkNode));
+        if (!nodes) return 0;
+        tree->nodes = nodes;
+        tree->capacity = capacity;
+    }
+    BkNode* node = &tree->nodes[tree->count];
+    node->word = word;
+    node->firstChild = 0;
+    node->nextSibling = 0;
+    node->distance = distance;
+    return tree->count++;
+}
+
+// Walk down from the root to the first node with no child at the word's
+// distance, and hang the word there
+bool bkTreeInsert(BkTree* tree, const Dictionary* dict, uint32_t word) {
+    if (tree->count == 0) {
+        addNode(tree, word, 0);
+        return tree->count == 1;
+    }
+
+    const char* text = dictionaryWord(dict, word);
+    uint32_t current = 0;
+    while (1) {
+        uint32_t other = tree->nodes[current].word;
+        int distance = boundedLevenshteinDistance(text, dict->lengths[word], dictionaryWord(dict, other),
+                                                  dict->lengths[other], INT_MAX);
+        if (distance == 0) {
+            // A word added back after removeWord takes over its old node
+            if (wordRemoved(dict, other)) tree->nodes[current].word = word;
+            return true;
+        }
+
+        uint32_t child = tree->nodes[current].firstChild;
+        while (child && tree->nodes[child].distance != (uint32_t)distance) {
+            child = tree->nodes[child].nextSibling;
+        }
+        if (child) {
+            current = child;
+            continue;
+        }
+
+        // addNode may move the array, so link through indices afterwards
+        uint32_t added = addNode(tree, word, (uint32_t)distance);
+        if (!added) return false;
+        tree->nodes[added].nextSibling = tree->nodes[current].firstChild;
+        tree->nodes[current].firstChild = added;
+        return true;
+    }
+}
+
+bool buildBkTree(BkTree* tree, const Dictionary* dict) {
+    // Words are added in dictionary order, so the tree holds a prefix of it
+    for (uint32_t i = tree->count; i < dict->count; i++) {
+        if (!bkTreeInsert(tree, dict, i)) return false;
+    }
+    return true;
+}
+
+bool bkTreeSearch(const BkTree* tree, const Dictionary* dict, const char* word, int maxDistance,
+                  SuggestionCallback callback, void* context) {
+    if (tree->count == 0) return true;
+    size_t length = strlen(word);
+
+    // Explicit stack of nodes still to visit
+    uint32_t localStack[256];
+    uint32_t* stack = localStack;
+    uint32_t stackCapacity = 256;
+    uint32_t depth = 0;
+    stack[depth++] = 0;
+
+    while (depth > 0) {
+        const BkNode* node = &tree->nodes[stack[--depth]];
+        const char* candidate = dictionaryWord(dict, node->word);
+        // Pruning needs the exact distance, not just whether it is in range
+        int distance = boundedLevenshteinDistance(word, length, candidate, dict->lengths[node->word], INT_MAX);
+        if (distance <= maxDistance) {
+            callback(candidate, distance, context);
+        }
+
+        // Only children within maxDistance of 'distance' can match
+        uint32_t low = distance > maxDistance ? (uint32_t)(distance - maxDistance) : 0;
+        uint32_t high = (uint32_t)(distance + maxDistance);
+        for (uint32_t child = node->firstChild; child; child = tree->nodes[child].nextSibling) {
+            uint32_t edge = tree->nodes[child].distance;
+            if (edge < low || edge > high) continue;
+            if (depth == stackCapacity) {
+                uint32_t* grown = malloc(2 * stackCapacity * sizeof(uint32_t));
+                if (!grown) {
+                    if (stack != localStack) free(stack);
+                    return false;
+                }
+                memcpy(grown, stack, depth * sizeof(uint32_t));
+                if (stack != localStack) free(stack);
+                stack = grown;
+                stackCapacity *= 2;
+            }
+            stack[depth++] = child;
+        }
+    }
+    if (stack != localStack) free(stack);
+    return true;
+}
+
+bool copyBkTree(BkTree* copy, const BkTree* tree) {
+    initializeBkTree(copy);
+    if (tree->count == 0) return true;
+    copy->nodes = malloc(tree->count * sizeof(BkNode));
+    if (!copy->nodes) return false;
+    memcpy(copy->nodes, tree->nodes, tree->count * sizeof(BkNode));
+    copy->count = tree->count;
+    copy->capacity = tree->count;
+    return true;
+}
+
+size_t bkTreeMemory(const BkTree* tree) {
+    return (size_t)tree->capacity * sizeof(BkNode);
+}
+
+void freeBkTree(BkTree* tree) {
+    free(tree->nodes);
+    initializeBkTree(tree);
+}
@@ -0,0 +1,287 @@
+#include "concurrent_dictionary.h"
+#include "symspell.h"
+#include "dawg.h"
+#include "word_table.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+// Unindexed tail, or removed words, (in 1/n of the words) after which an
+// update rebuilds the SymSpell or DAWG index, or the whole dictionary
+#define REINDEX_FRACTION 16
+
+// One per reader thread, on its own cache line. 'epoch' is the global epoch
+// seen when the current read began, or 0 while the reader is idle.
+typedef struct ReaderSlot {
+    _Atomic uint64_t epoch;
+    char padding[56];
+} ReaderSlot;
+
+// A replaced snapshot, freed once every active reader started at or after
+// 'epoch'. An index its successor shares is freed with the successor.
+typedef struct RetiredSnapshot {
+    Dictionary* dict;
+    uint64_t epoch;
+    bool sharesSymSpell;
+    bool sharesDawg;
+} RetiredSnapshot;
+
+struct ConcurrentDictionary {
+    _Atomic(Dictionary*) current;
+    _Atomic uint64_t epoch;
+    ReaderSlot* readers;
+    int maxReaders;
+    _Atomic int readerCount;
+
+    pthread_mutex_t writeLock;  // Serialises writers; readers never take it
+    RetiredSnapshot* retired;
+    int retiredCount;
+    int retiredCapacity;
+};
+
+ConcurrentDictionary* createConcurrentDictionary(Dictionary* initial, int maxReaders) {
+    ConcurrentDictionary* shared = calloc(1, sizeof(ConcurrentDictionary));
+    Dictionary* dict = malloc(sizeof(Dictionary));
+    ReaderSlot* readers = calloc(maxReaders > 0 ? maxReaders : 1, sizeof(ReaderSlot));
+    if (!shared || !dict || !readers) {
+        free(shared);
+        free(dict);
+        free(readers);
+        return NULL;
+    }
+    *dict = *initial;
+    initializeDictionary(initial);
+
+    atomic_init(&shared->current, dict);
+    atomic_init(&shared->epoch, 1);
+    atomic_init(&shared->readerCount, 0);
+    shared->readers = readers;
+    shared->maxReaders = maxReaders;
+    for (int i = 0; i < maxReaders; i++) atomic_init(&readers[i].epoch, 0);
+    pthread_mutex_init(&shared->writeLock, NULL);
+    return shared;
+}
+
+int registerDictionaryReader(ConcurrentDictionary* shared) {
+    int reader = atomic_fetch_add(&shared->readerCount, 1);
+    return reader < shared->maxReaders ? reader : -1;
+}
+
+const Dictionary* beginDictionaryRead(ConcurrentDictionary* shared, int reader) {
+    // Announce the epoch before loading the pointer (both sequentially
+    // consistent): a writer that misses this announcement published its
+    // snapshot before it, so the load below returns the new one
+    atomic_store(&shared->readers[reader].epoch, atomic_load(&shared->epoch));
+    return atomic_load(&shared->current);
+}
+
+void endDictionaryRead(ConcurrentDictionary* shared, int reader) {
+    atomic_store_explicit(&shared->readers[reader].epoch, 0, memory_order_release);
+}
+
+// Frees retired snapshots that no active reader can still see. With
+// 'wait', spins until all of them are gone.
+static void reclaimSnapshots(ConcurrentDictionary* shared, bool wait) {
+    while (shared->retiredCount > 0) {
+        uint64_t oldest = UINT64_MAX;
+        int readerCount = atomic_load(&shared->readerCount);
+        if (readerCount > shared->maxReaders) readerCount = shared->maxReaders;
+        for (int i = 0; i < readerCount; i++) {
+            uint64_t epoch = atomic_load(&shared->readers[i].epoch);
+            if (epoch != 0 && epoch < oldest) oldest = epoch;
+        }
+        int kept = 0;
+        for (int i = 0; i < shared->retiredCount; i++) {
+            if (shared->retired[i].epoch <= oldest) {
+                Dictionary* dict = shared->retired[i].dict;
+                if (shared->retired[i].sharesSymSpell) dict->symSpell = NULL;
+                if (shared->retired[i].sharesDawg) dict->dawg = NULL;
+                freeDictionary(dict);
+                free(dict);
+            } else {
+                shared->retired[kept++] = shared->retired[i];
+            }
+        }
+        shared->retiredCount = kept;
+        if (!wait) return;
+        if (kept > 0) sched_yield();
+    }
+}
+
+// insertWord that tells a word already present, or one no dictionary can
+// hold, apart from running out of memory: returns false only for the latter
+static bool addWord(Dictionary* dict, const char* word) {
+    if (insertWord(dict, word)) return true;
+    size_t length = strlen(word);
+    return length == 0 || length > MAX_WORD_LENGTH || searchWord(dict, word);
+}
+
+// Copy of the current snapshot to build the next one in. The SymSpell and
+// DAWG indexes never change once built, so the copy shares them instead of
+// copying them, unless they live in a mapped image that goes away with the
+// current snapshot.
+static Dictionary* copySnapshot(const Dictionary* current) {
+    Dictionary* next = malloc(sizeof(Dictionary));
+    if (!next) return NULL;
+    Dictionary unindexed = *current;
+    if (!current->image) {
+        unindexed.symSpell = NULL;
+        unindexed.dawg = NULL;
+    }
+    if (!copyDictionary(next, &unindexed)) {
+        free(next);
+        return NULL;
+    }
+    if (!current->image) {
+        next->symSpell = current->symSpell;
+        next->dawg = current->dawg;
+    }
+    return next;
+}
+
+// Frees a snapshot that was never published, except the indexes it shares
+// with the current one
+static void discardSnapshot(Dictionary* next, const Dictionary* current) {
+    if (next->symSpell == current->symSpell) next->symSpell = NULL;
+    if (next->dawg == current->dawg) next->dawg = NULL;
+    freeDictionary(next);
+    free(next);
+}
+
+// Builds a new SymSpell or DAWG index for 'next' once the words the old one
+// does not cover grow too many. The old index is left alone if 'current'
+// shares it, and kept on failure.
+static bool reindexSnapshot(Dictionary* next, const Dictionary* current) {
+    SuggestEngine engine = next->engine;
+    bool built = true;
+    SymSpellIndex* symSpell = next->symSpell;
+    if (symSpell && next->count - symSpell->wordCount > next->count / REINDEX_FRACTION) {
+        next->symSpell = NULL;
+        built = setSuggestEngine(next, SUGGEST_SYMSPELL);
+        if (!built) {
+            next->symSpell = symSpell;
+        } else if (symSpell != current->symSpell) {
+            freeSymSpell(symSpell);
+            free(symSpell);
+        }
+    }
+    Dawg* dawg = next->dawg;
+    if (built && dawg && next->count - dawg->wordCount > next->count / REINDEX_FRACTION) {
+        next->dawg = NULL;
+        built = setSuggestEngine(next, SUGGEST_DAWG);
+        if (!built) {
+            next->dawg = dawg;
+        } else if (dawg != current->dawg) {
+            freeDawg(dawg);
+            free(dawg);
+        }
+    }
+    next->engine = engine;
+    return built;
+}
+
+// The words of 'dict' that were not removed, with the active engine's
+// index and the fast path built afresh
+static Dictionary* compactSnapshot(const Dictionary* dict) {
+    Dictionary* next = malloc(sizeof(Dictionary));
+    if (!next) return NULL;
+    initializeDictionary(next);
+    bool built = true;
+    if (dict->frequencies) {
+        next->frequencies = calloc(dict->count ? dict->count : 1, sizeof(uint32_t));
+        built = next->frequencies != NULL;
+    }
+    for (uint32_t i = 0; built && i < dict->count; i++) {
+        if (wordRemoved(dict, i)) continue;
+        built = insertWord(next, dictionaryWord(dict, i));
+        if (built && dict->frequencies) next->frequencies[next->count - 1] = dict->frequencies[i];
+    }
+    if (built) built = setSuggestEngine(next, dict->engine);
+    if (built && dict->wordTable) built = enableFastLookup(next, dict->wordTable->bloom != NULL);
+    if (!built) {
+        freeDictionary(next);
+        free(next);
+        return NULL;
+    }
+    return next;
+}
+
+// Next snapshot: a copy of the current one with the words added and then
+// removed in place, so a word in both lists ends up removed. The BK-tree
+// and the fast path follow every change; removed words stay in the
+// suggestion indexes, marked, until there are too many of them and the
+// dictionary is compacted.
+static Dictionary* updateSnapshot(const Dictionary* current, const char* const* add, int addCount,
+                                  const char* const* remove, int removeCount) {
+    Dictionary* next = copySnapshot(current);
+    if (!next) return NULL;
+    bool built = true;
+    for (int i = 0; built && i < addCount; i++) built = addWord(next, add[i]);
+    for (int i = 0; built && i < removeCount; i++) built = removeWord(next, remove[i]) >= 0;
+    if (built && next->removedCount > next->count / REINDEX_FRACTION) {
+        Dictionary* compact = compactSnapshot(next);
+        discardSnapshot(next, current);
+        return compact;
+    }
+    if (built) built = reindexSnapshot(next, current);
+    if (!built) {
+        discardSnapshot(next, current);
+        return NULL;
+    }
+    return next;
+}
+
+int updateConcurrentDictionary(ConcurrentDictionary* shared, const char* const* add, int addCount,
+                               const char* const* remove, int removeCount) {
+    pthread_mutex_lock(&shared->writeLock);
+    Dictionary* current = atomic_load(&shared->current);
+    Dictionary* next = updateSnapshot(current, add, addCount, remove, removeCount);
+    if (!next) {
+        pthread_mutex_unlock(&shared->writeLock);
+        return -1;
+    }
+    // Make room for the snapshot about to be retired
+    if (shared->retiredCount == shared->retiredCapacity) {
+        int capacity = shared->retiredCapacity ? shared->retiredCapacity * 2 : 8;
+        RetiredSnapshot* retired = realloc(shared->retired, capacity * sizeof(RetiredSnapshot));
+        if (!retired) {
+            discardSnapshot(next, current);
+            pthread_mutex_unlock(&shared->writeLock);
+            return -1;
+        }
+        shared->retired = retired;
+        shared->retiredCapacity = capacity;
+    }
+
+    // Publish, then open a new epoch: readers that announce it (or later)
+    // loaded the pointer after the store and cannot see 'current'
+    atomic_store(&shared->current, next);
+    uint64_t epoch = atomic_fetch_add(&shared->epoch, 1) + 1;
+    shared->retired[shared->retiredCount].dict = current;
+    shared->retired[shared->retiredCount].epoch = epoch;
+    shared->retired[shared->retiredCount].sharesSymSpell = current->symSpell && next->symSpell == current->symSpell;
+    shared->retired[shared->retiredCount].sharesDawg = current->dawg && next->dawg == current->dawg;
+    shared->retiredCount++;
+    reclaimSnapshots(shared, false);
+    pthread_mutex_unlock(&shared->writeLock);
+    return 0;
+}
+
+uint32_t concurrentDictionarySize(ConcurrentDictionary* shared) {
+    const Dictionary* current = atomic_load(&shared->current);
+    return current->count - current->removedCount;
+}
+
+void freeConcurrentDictionary(ConcurrentDictionary* shared) {
+    if (!shared) return;
+    pthread_mutex_lock(&shared->writeLock);
+    reclaimSnapshots(shared, true);
+    pthread_mutex_unlock(&shared->writeLock);
+    Dictionary* current = atomic_load(&shared->current);
+    freeDictionary(current);
+    free(current);
+    pthread_mutex_destroy(&shared->writeLock);
+    free(shared->retired);
+    free(shared->readers);
+    free(shared);
+}
@@ -0,0 +1,330 @@
+#include "dawg.h"
+
+// A node of the path to the last word added; its edges can still change
+typedef struct OpenState {
+    DawgEdge edges[256];
+    int edgeCount;
+    bool final;
+} OpenState;
+
+// Incremental construction from sorted words (Daciuk et al.): once a new
+// word leaves a branch, the branch can no longer change, so its nodes are
+// frozen bottom-up and merged with an equal node already in the register
+typedef struct DawgBuilder {
+    Dawg* dawg;
+    uint32_t nodeCapacity;
+    uint32_t edgeCapacity;
+    HashSlot* slots;        // Register of frozen nodes: hash, node index + 1
+    uint32_t slotCount;
+    OpenState* open;        // open[d] is the state at depth d of the path
+} DawgBuilder;
+
+typedef struct SortedWord {
+    const char* text;
+    uint32_t index;
+} SortedWord;
+
+void initializeDawg(Dawg* dawg) {
+    memset(dawg, 0, sizeof(*dawg));
+}
+
+static int compareWords(const void* a, const void* b) {
+    return strcmp(((const SortedWord*)a)->text, ((const SortedWord*)b)->text);
+}
+
+// FNV-1a over the final flag and the (label, target) pairs
+static uint32_t hashState(bool final, const DawgEdge* edges, int edgeCount) {
+    uint32_t hash = 2166136261u ^ (final ? 1u : 0u);
+    hash *= 16777619u;
+    for (int i = 0; i < edgeCount; i++) {
+        uint32_t parts[2] = { edges[i].label, edges[i].target };
+        for (int p = 0; p < 2; p++) {
+            hash ^= parts[p];
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+static bool sameState(const Dawg* dawg, uint32_t node, const OpenState* state) {
+    uint32_t first = dawg->firstEdge[node];
+    if ((int)(dawg->firstEdge[node + 1] - first) != state->edgeCount) return false;
+    if ((dawg->final[node] != 0) != state->final) return false;
+    for (int i = 0; i < state->edgeCount; i++) {
+        const DawgEdge* edge = &dawg->edges[first + i];
+        if (edge->label != state->edges[i].label || edge->target != state->edges[i].target) return false;
+    }
+    return true;
+}
+
+static bool growRegister(DawgBuilder* builder) {
+    uint32_t slotCount = builder->slotCount ? builder->slotCount * 2 : 1024;
+    HashSlot* slots = calloc(slotCount, sizeof(HashSlot));
+    if (!slots) return false;
+    for (uint32_t s = 0; s < builder->slotCount; s++) {
+        if (!builder->slots[s].word) continue;
+        uint32_t i = builder->slots[s].hash & (slotCount - 1);
+        while (slots[i].word) i = (i + 1) & (slotCount - 1);
+        slots[i] = builder->slots[s];
+    }
+    free(builder->slots);
+    builder->slots = slots;
+    builder->slotCount = slotCount;
+    return true;
+}
+
+// Node equal to 'state', added if the register has none. Returns false if
+// memory or node numbers run out.
+static bool freezeState(DawgBuilder* builder, const OpenState* state, uint32_t* node) {
+    Dawg* dawg = builder->dawg;
+    uint32_t hash = hashState(state->final, state->edges, state->edgeCount);
+    uint32_t mask = builder->slotCount - 1;
+    uint32_t i = hash & mask;
+    while (builder->slots[i].word) {
+        if (builder->slots[i].hash == hash && sameState(dawg, builder->slots[i].word - 1, state)) {
+            *node = builder->slots[i].word - 1;
+            return true;
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (dawg->nodeCount == DAWG_MAX_NODES) return false;
+    // firstEdge needs one entry past the last node
+    if (dawg->nodeCount + 2 > builder->nodeCapacity) {
+        uint32_t capacity = builder->nodeCapacity ? builder->nodeCapacity * 2 : 1024;
+        uint32_t* firstEdge = realloc(dawg->firstEdge, capacity * sizeof(uint32_t));
+        if (!firstEdge) return false;
+        dawg->firstEdge = firstEdge;
+        uint8_t* final = realloc(dawg->final, capacity);
+        if (!final) return false;
+        dawg->final = final;
+        builder->nodeCapacity = capacity;
+    }
+    if (dawg->edgeCount + state->edgeCount > builder->edgeCapacity) {
+        uint32_t capacity = builder->edgeCapacity ? builder->edgeCapacity : 1024;
+        while (capacity < dawg->edgeCount + state->edgeCount) capacity *= 2;
+        DawgEdge* edges = realloc(dawg->edges, capacity * sizeof(DawgEdge));
+        if (!edges) return false;
+        dawg->edges = edges;
+        builder->edgeCapacity = capacity;
+    }
+    *node = dawg->nodeCount++;
+    dawg->firstEdge[*node] = dawg->edgeCount;
+    dawg->final[*node] = state->final;
+    if (state->edgeCount) memcpy(&dawg->edges[dawg->edgeCount], state->edges, state->edgeCount * sizeof(DawgEdge));
+    dawg->edgeCount += state->edgeCount;
+    dawg->firstEdge[*node + 1] = dawg->edgeCount;
+
+    builder->slots[i].hash = hash;
+    builder->slots[i].word = *node + 1;
+    if (2 * dawg->nodeCount > builder->slotCount) return growRegister(builder);
+    return true;
+}
+
+// Freezes the path below 'depth', deepest state first
+static bool freezePath(DawgBuilder* builder, int pathDepth, int depth) {
+    for (int d = pathDepth; d > depth; d--) {
+        uint32_t node;
+        if (!freezeState(builder, &builder->open[d], &node)) return false;
+        OpenState* parent = &builder->open[d - 1];
+        parent->edges[parent->edgeCount - 1].target = node;
+    }
+    return true;
+}
+
+// Word counts below each node give every edge its rank offset. Children
+// are always frozen before their parents, so node order is bottom-up.
+static bool assignRanks(Dawg* dawg) {
+    uint32_t* words = malloc((dawg->nodeCount ? dawg->nodeCount : 1) * sizeof(uint32_t));
+    if (!words) return false;
+    for (uint32_t n = 0; n < dawg->nodeCount; n++) {
+        uint32_t total = dawg->final[n];
+        for (uint32_t e = dawg->firstEdge[n]; e < dawg->firstEdge[n + 1]; e++) {
+            dawg->edges[e].skip = total;
+            total += words[dawg->edges[e].target];
+        }
+        words[n] = total;
+    }
+    free(words);
+    return true;
+}
+
+bool buildDawg(Dawg* dawg, const Dictionary* dict) {
+    freeDawg(dawg);
+    SortedWord* sorted = malloc((dict->count ? dict->count : 1) * sizeof(SortedWord));
+    OpenState* open = malloc((MAX_WORD_LENGTH + 1) * sizeof(OpenState));
+    DawgBuilder builder = { dawg, 0, 0, NULL, 0, open };
+    dawg->sortedWords = malloc((dict->count ? dict->count : 1) * sizeof(uint32_t));
+    bool built = sorted && open && dawg->sortedWords && growRegister(&builder);
+    if (built) {
+        for (uint32_t i = 0; i < dict->count; i++) {
+            sorted[i].text = dictionaryWord(dict, i);
+            sorted[i].index = i;
+        }
+        qsort(sorted, dict->count, sizeof(SortedWord), compareWords);
+        open[0].edgeCount = 0;
+        open[0].final = false;
+    }
+
+    int pathDepth = 0;
+    const char* previous = "";
+    for (uint32_t r = 0; built && r < dict->count; r++) {
+        const char* word = sorted[r].text;
+        dawg->sortedWords[r] = sorted[r].index;
+        int common = 0;
+        while (word[common] && word[common] == previous[common]) common++;
+        built = freezePath(&builder, pathDepth, common);
+
+        // Append the rest of the word below the common prefix
+        int depth = common;
+        for (; built && word[depth]; depth++) {
+            OpenState* state = &open[depth];
+            state->edges[state->edgeCount].label = (unsigned char)word[depth];
+            state->edges[state->edgeCount].target = 0;
+            state->edges[state->edgeCount].skip = 0;
+            state->edgeCount++;
+            open[depth + 1].edgeCount = 0;
+            open[depth + 1].final = false;
+        }
+        open[depth].final = true;
+        pathDepth = depth;
+        previous = word;
+    }
+    if (built) built = freezePath(&builder, pathDepth, 0) && freezeState(&builder, &open[0], &dawg->root);
+    if (built) built = assignRanks(dawg);
+
+    free(sorted);
+    free(open);
+    free(builder.slots);
+    if (!built) {
+        freeDawg(dawg);
+        return false;
+    }
+    dawg->wordCount = dict->count;
+    // Trim the growth slack; the automaton is read-only from here
+    DawgEdge* edges = realloc(dawg->edges, (dawg->edgeCount ? dawg->edgeCount : 1) * sizeof(DawgEdge));
+    if (edges) dawg->edges = edges;
+    return true;
+}
+
+long dawgLookup(const Dawg* dawg, const char* word) {
+    if (dawg->wordCount == 0) return -1;
+    uint32_t node = dawg->root;
+    uint32_t rank = 0;
+    for (const unsigned char* p = (const unsigned char*)word; *p; p++) {
+        uint32_t e = dawg->firstEdge[node];
+        uint32_t end = dawg->firstEdge[node + 1];
+        while (e < end && dawg->edges[e].label < *p) e++;
+        if (e == end || dawg->edges[e].label != *p) return -1;
+        rank += dawg->edges[e].skip;
+        node = dawg->edges[e].target;
+    }
+    return dawg->final[node] ? (long)dawg->sortedWords[rank] : -1;
+}
+
+bool dawgSearch(const Dawg* dawg, const Dictionary* dict, const char* word, int maxDistance,
+                SuggestionCallback callback, void* context) {
+    if (dawg->wordCount == 0) return true;
+    int length = (int)strlen(word);
+    // Matches are at most length + maxDistance long
+    int maxDepth = length + maxDistance;
+    if (maxDepth > MAX_WORD_LENGTH) maxDepth = MAX_WORD_LENGTH;
+    size_t rowsSize = (size_t)(maxDepth + 1) * (length + 1);
+    size_t frameCount = (size_t)maxDepth + 1;
+
+    // Row d holds the distances between the first d characters of the path
+    // and every prefix of 'word'
+    int localRows[1024];
+    uint32_t localFrames[3 * 64];
+    int* rows = rowsSize <= 1024 ? localRows : malloc(rowsSize * sizeof(int));
+    uint32_t* frames = frameCount <= 64 ? localFrames : malloc(3 * frameCount * sizeof(uint32_t));
+    if (!rows || !frames) {
+        if (rows != localRows) free(rows);
+        if (frames != localFrames) free(frames);
+        return false;
+    }
+    // Per depth: node, next edge to follow, rank of the node's own word
+    uint32_t* nodes = frames;
+    uint32_t* nextEdge = frames + frameCount;
+    uint32_t* ranks = frames + 2 * frameCount;
+
+    for (int j = 0; j <= length; j++) rows[j] = j;
+    nodes[0] = dawg->root;
+    nextEdge[0] = dawg->firstEdge[dawg->root];
+    ranks[0] = 0;
+    int depth = 0;
+    while (depth >= 0) {
+        uint32_t node = nodes[depth];
+        if (nextEdge[depth] == dawg->firstEdge[node + 1]) {
+            depth--;
+            continue;
+        }
+        const DawgEdge* edge = &dawg->edges[nextEdge[depth]++];
+        const int* previous = rows + (size_t)depth * (length + 1);
+        int* current = rows + (size_t)(depth + 1) * (length + 1);
+        current[0] = previous[0] + 1;
+        int rowMinimum = current[0];
+        for (int j = 1; j <= length; j++) {
+            int cost = (unsigned char)word[j - 1] == edge->label ? 0 : 1;
+            int value = previous[j - 1] + cost;
+            if (previous[j] + 1 < value) value = previous[j] + 1;
+            if (current[j - 1] + 1 < value) value = current[j - 1] + 1;
+            current[j] = value;
+            if (value < rowMinimum) rowMinimum = value;
+        }
+
+        uint32_t rank = ranks[depth] + edge->skip;
+        if (dawg->final[edge->target] && current[length] <= maxDistance) {
+            callback(dictionaryWord(dict, dawg->sortedWords[rank]), current[length], context);
+        }
+        // Deeper rows never drop below this row's minimum
+        if (rowMinimum <= maxDistance && depth + 1 < maxDepth &&
+            dawg->firstEdge[edge->target] != dawg->firstEdge[edge->target + 1]) {
+            depth++;
+            nodes[depth] = edge->target;
+            nextEdge[depth] = dawg->firstEdge[edge->target];
+            ranks[depth] = rank;
+        }
+    }
+    if (rows != localRows) free(rows);
+    if (frames != localFrames) free(frames);
+    return true;
+}
+
+size_t dawgMemory(const Dawg* dawg) {
+    return (size_t)(dawg->nodeCount + 1) * sizeof(uint32_t) + dawg->nodeCount +
+        (size_t)dawg->edgeCount * sizeof(DawgEdge);
+}
+
+bool copyDawg(Dawg* copy, const Dawg* dawg) {
+    initializeDawg(copy);
+    if (!dawg->firstEdge) return true;
+    size_t firstEdgeSize = (dawg->nodeCount + 1) * sizeof(uint32_t);
+    size_t edgesSize = dawg->edgeCount * sizeof(DawgEdge);
+    size_t sortedSize = dawg->wordCount * sizeof(uint32_t);
+    copy->firstEdge = malloc(firstEdgeSize);
+    copy->final = malloc(dawg->nodeCount ? dawg->nodeCount : 1);
+    copy->edges = malloc(edgesSize ? edgesSize : 1);
+    copy->sortedWords = malloc(sortedSize ? sortedSize : 1);
+    if (!copy->firstEdge || !copy->final || !copy->edges || !copy->sortedWords) {
+        freeDawg(copy);
+        return false;
+    }
+    memcpy(copy->firstEdge, dawg->firstEdge, firstEdgeSize);
+    memcpy(copy->final, dawg->final, dawg->nodeCount);
+    memcpy(copy->edges, dawg->edges, edgesSize);
+    memcpy(copy->sortedWords, dawg->sortedWords, sortedSize);
+    copy->nodeCount = dawg->nodeCount;
+    copy->edgeCount = dawg->edgeCount;
+    copy->root = dawg->root;
+    copy->wordCount = dawg->wordCount;
+    return true;
+}
+
+void freeDawg(Dawg* dawg) {
+    free(dawg->firstEdge);
+    free(dawg->final);
+    free(dawg->edges);
+    free(dawg->sortedWords);
+    initializeDawg(dawg);
+}
@@ -0,0 +1,209 @@
+#include "dictionary_image.h"
+#include "bk_tree.h"
+#include "symspell.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t alignSection(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+// Pads the file up to 'offset' and writes one array there
+static bool writeSection(FILE* file, uint64_t* position, uint64_t offset, const void* data, size_t size) {
+    static const char zeros[8] = {0};
+    if (fwrite(zeros, 1, offset - *position, file) != offset - *position) return false;
+    if (size > 0 && fwrite(data, 1, size, file) != size) return false;
+    *position = offset + size;
+    return true;
+}
+
+int writeDictionaryImage(Dictionary* dict, const char* path) {
+    // The image format has no room for the marks left by removeWord
+    if (dict->removedCount > 0) return -1;
+    SuggestEngine engine = dict->engine;
+    if (!setSuggestEngine(dict, SUGGEST_BKTREE) || !setSuggestEngine(dict, SUGGEST_SYMSPELL)) return -1;
+    dict->engine = engine;
+    // The SymSpell index does not follow insertWord; bring it up to date
+    if (dict->symSpell->wordCount != dict->count && !buildSymSpell(dict->symSpell, dict)) return -1;
+
+    const BkTree* tree = dict->bkTree;
+    const SymSpellIndex* index = dict->symSpell;
+    uint32_t postingCount = index->hashCount ? index->starts[index->hashCount] : 0;
+    size_t directorySize = index->hashCount ? ((size_t)(1u << index->directoryBits) + 1) * sizeof(uint32_t) : 0;
+
+    DictionaryImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DICTIONARY_IMAGE_MAGIC, 4);
+    header.version = DICTIONARY_IMAGE_VERSION;
+    header.headerSize = sizeof(header);
+    header.count = dict->count;
+    header.poolSize = dict->poolSize;
+    header.slotCount = dict->slotCount;
+    header.bkNodeCount = tree->count;
+    header.symSpellHashCount = index->hashCount;
+    header.symSpellPostingCount = postingCount;
+    header.symSpellDirectoryBits = (uint32_t)index->directoryBits;
+    header.symSpellWordCount = index->wordCount;
+    header.hasFrequencies = dict->frequencies != NULL;
+    size_t frequenciesSize = dict->frequencies ? dict->count * sizeof(uint32_t) : 0;
+
+    uint64_t offset = alignSection(sizeof(header));
+    header.poolOffset = offset;
+    offset = alignSection(offset + dict->poolSize);
+    header.offsetsOffset = offset;
+    offset = alignSection(offset + (uint64_t)dict->count * sizeof(uint32_t));
+    header.lengthsOffset = offset;
+    offset = alignSection(offset + dict->count);
+    header.frequenciesOffset = offset;
+    offset = alignSection(offset + frequenciesSize);
+    header.slotsOffset = offset;
+    offset = alignSection(offset + (uint64_t)dict->slotCount * sizeof(HashSlot));
+    header.bkNodesOffset = offset;
+    offset = alignSection(offset + (uint64_t)tree->count * sizeof(BkNode));
+    header.hashesOffset = offset;
+    offset = alignSection(offset + (uint64_t)index->hashCount * sizeof(uint64_t));
+    header.startsOffset = offset;
+    offset = alignSection(offset + (index->hashCount ? (uint64_t)(index->hashCount + 1) * sizeof(uint32_t) : 0));
+    header.postingsOffset = offset;
+    offset = alignSection(offset + (uint64_t)postingCount * sizeof(uint32_t));
+    header.directoryOffset = offset;
+    header.fileSize = offset + directorySize;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return -1;
+    uint64_t position = 0;
+    bool written = writeSection(file, &position, 0, &header, sizeof(header)) &&
+        writeSection(file, &position, header.poolOffset, dict->pool, dict->poolSize) &&
+        writeSection(file, &position, header.offsetsOffset, dict->offsets, dict->count * sizeof(uint32_t)) &&
+        writeSection(file, &position, header.lengthsOffset, dict->lengths, dict->count) &&
+        writeSection(file, &position, header.frequenciesOffset, dict->frequencies, frequenciesSize) &&
+        writeSection(file, &position, header.slotsOffset, dict->slots, dict->slotCount * sizeof(HashSlot)) &&
+        writeSection(file, &position, header.bkNodesOffset, tree->nodes, tree->count * sizeof(BkNode)) &&
+        writeSection(file, &position, header.hashesOffset, index->hashes, index->hashCount * sizeof(uint64_t)) &&
+        writeSection(file, &position, header.startsOffset, index->starts,
+                     index->hashCount ? (index->hashCount + 1) * sizeof(uint32_t) : 0) &&
+        writeSection(file, &position, header.postingsOffset, index->postings, postingCount * sizeof(uint32_t)) &&
+        writeSection(file, &position, header.directoryOffset, index->directory, directorySize);
+    if (fclose(file) != 0) written = false;
+    return written ? 0 : -1;
+}
+
+// An array of 'size' bytes at 'offset' lies within the file
+static bool sectionFits(const DictionaryImageHeader* header, uint64_t offset, uint64_t size) {
+    return offset % 8 == 0 && offset <= header->fileSize && size <= header->fileSize - offset;
+}
+
+static bool validImage(const DictionaryImageHeader* header, uint64_t fileSize) {
+    if (memcmp(header->magic, DICTIONARY_IMAGE_MAGIC, 4) != 0) return false;
+    if (header->version != DICTIONARY_IMAGE_VERSION || header->headerSize != sizeof(*header)) return false;
+    if (header->fileSize != fileSize) return false;
+    if (header->count > 0 && (header->slotCount < 2 * header->count ||
+                              (header->slotCount & (header->slotCount - 1)) != 0)) return false;
+    if (header->bkNodeCount > header->count || header->symSpellWordCount > header->count) return false;
+    if (header->symSpellHashCount > 0 && (header->symSpellDirectoryBits < 1 || header->symSpellDirectoryBits > 24)) {
+        return false;
+    }
+    uint64_t directoryEntries = header->symSpellHashCount ? (1ull << header->symSpellDirectoryBits) + 1 : 0;
+    uint64_t startEntries = header->symSpellHashCount ? (uint64_t)header->symSpellHashCount + 1 : 0;
+    return sectionFits(header, header->poolOffset, header->poolSize) &&
+        sectionFits(header, header->offsetsOffset, (uint64_t)header->count * sizeof(uint32_t)) &&
+        sectionFits(header, header->lengthsOffset, header->count) &&
+        sectionFits(header, header->frequenciesOffset,
+                    header->hasFrequencies ? (uint64_t)header->count * sizeof(uint32_t) : 0) &&
+        sectionFits(header, header->slotsOffset, (uint64_t)header->slotCount * sizeof(HashSlot)) &&
+        sectionFits(header, header->bkNodesOffset, (uint64_t)header->bkNodeCount * sizeof(BkNode)) &&
+        sectionFits(header, header->hashesOffset, (uint64_t)header->symSpellHashCount * sizeof(uint64_t)) &&
+        sectionFits(header, header->startsOffset, startEntries * sizeof(uint32_t)) &&
+        sectionFits(header, header->postingsOffset, (uint64_t)header->symSpellPostingCount * sizeof(uint32_t)) &&
+        sectionFits(header, header->directoryOffset, directoryEntries * sizeof(uint32_t));
+}
+
+int mapDictionaryImage(Dictionary* dict, const char* path) {
+    if (dict->count > 0 || dict->image) return -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < sizeof(DictionaryImageHeader)) {
+        close(fd);
+        return -1;
+    }
+    // Read-only and shared: every process mapping the image uses the same pages
+    void* base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+    const char* image = (const char*)base;
+    const DictionaryImageHeader* header = (const DictionaryImageHeader*)base;
+    if (!validImage(header, (uint64_t)info.st_size)) {
+        munmap(base, (size_t)info.st_size);
+        return -1;
+    }
+
+    BkTree* tree = NULL;
+    SymSpellIndex* index = NULL;
+    if (header->bkNodeCount > 0) {
+        tree = malloc(sizeof(BkTree));
+        if (!tree) {
+            munmap(base, (size_t)info.st_size);
+            return -1;
+        }
+        tree->nodes = (BkNode*)(image + header->bkNodesOffset);
+        tree->count = header->bkNodeCount;
+        tree->capacity = header->bkNodeCount;
+    }
+    if (header->symSpellHashCount > 0) {
+        index = malloc(sizeof(SymSpellIndex));
+        if (!index) {
+            free(tree);
+            munmap(base, (size_t)info.st_size);
+            return -1;
+        }
+        index->hashes = (uint64_t*)(image + header->hashesOffset);
+        index->starts = (uint32_t*)(image + header->startsOffset);
+        index->postings = (uint32_t*)(image + header->postingsOffset);
+        index->hashCount = header->symSpellHashCount;
+        index->directory = (uint32_t*)(image + header->directoryOffset);
+        index->directoryBits = (int)header->symSpellDirectoryBits;
+        index->wordCount = header->symSpellWordCount;
+    }
+
+    // The arrays are only read until detachDictionaryImage copies them
+    dict->pool = (char*)(image + header->poolOffset);
+    dict->poolSize = header->poolSize;
+    dict->poolCapacity = header->poolSize;
+    dict->offsets = (uint32_t*)(image + header->offsetsOffset);
+    dict->lengths = (uint8_t*)(image + header->lengthsOffset);
+    dict->frequencies = header->hasFrequencies ? (uint32_t*)(image + header->frequenciesOffset) : NULL;
+    dict->count = header->count;
+    dict->capacity = header->count;
+    dict->slots = (HashSlot*)(image + header->slotsOffset);
+    dict->slotCount = header->slotCount;
+    dict->bkTree = tree;
+    dict->symSpell = index;
+    dict->image = base;
+    dict->imageSize = (size_t)info.st_size;
+    return (int)dict->count;
+}
+
+bool detachDictionaryImage(Dictionary* dict) {
+    if (!dict->image) return true;
+    Dictionary copy;
+    if (!copyDictionary(&copy, dict)) return false;
+    // Releases the index headers and the mapping
+    freeDictionary(dict);
+    *dict = copy;
+    return true;
+}
+
+bool inDictionaryImage(const Dictionary* dict, const void* data) {
+    const char* image = (const char*)dict->image;
+    return image && (const char*)data >= image && (const char*)data < image + dict->imageSize;
+}
+
+void unmapDictionaryImage(Dictionary* dict) {
+    if (!dict->image) return;
+    munmap((void*)dict->image, dict->imageSize);
+    dict->image = NULL;
+    dict->imageSize = 0;
+}
@@ -0,0 +1,566 @@
+#include "server.h"
+#include "concurrent_dictionary.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Bytes requested from a client per recv
+#define READ_SIZE 16384
+
+typedef struct Client {
+    int fd;
+    uint64_t id;            // Finds the client again when its update is done
+    char* input;            // Received bytes not yet handled
+    size_t inputSize;
+    size_t inputCapacity;
+    char* output;           // Responses; output[outputSent..outputSize) is still unsent
+    size_t outputSize;
+    size_t outputSent;
+    size_t outputCapacity;
+    bool updating;          // An ADD or REMOVE is with the writer; later requests wait for it
+    bool quit;              // QUIT or a protocol error: answer nothing more
+    bool peerClosed;        // No more requests will arrive
+    bool failed;            // Socket error or out of memory: drop at once
+} Client;
+
+// An ADD or REMOVE for the writer thread, with its own copy of the words,
+// and then its result
+typedef struct Update {
+    struct Update* next;
+    uint64_t client;
+    bool add;
+    int status;             // From updateConcurrentDictionary
+    uint32_t size;          // Words in the snapshot it published
+    int count;
+    const char* words[];    // Followed by the text of the words
+} Update;
+
+typedef struct Server {
+    ConcurrentDictionary* shared;
+    int reader;
+    const ServerOptions* options;
+    const char** words;     // Arguments of the request being handled
+    Client* clients;
+    int clientCount;
+    int clientCapacity;
+    uint64_t nextClientId;
+    struct pollfd* fds;     // Listener, stop pipe, update pipe, then one per client
+
+    // Updates run on a writer thread so that the loop keeps answering
+    // reads from the current snapshot while the next one is built
+    pthread_t writer;
+    pthread_mutex_t updateLock; // Guards the two queues and 'stopping'
+    pthread_cond_t updateQueued;
+    Update* queued;
+    Update** queuedTail;
+    Update* done;
+    Update** doneTail;
+    bool stopping;
+    int updatePipe[2];      // Written by the writer after each update to wake poll()
+} Server;
+
+// Written by the signal handler to wake poll()
+static int stopPipe[2] = { -1, -1 };
+
+static void requestStop(int signal) {
+    (void)signal;
+    int saved = errno;
+    if (write(stopPipe[1], "", 1) < 0) {
+        // Pipe full: a stop is already pending
+    }
+    errno = saved;
+}
+
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Room for 'bytes' more output bytes plus a terminator
+static bool reserveOutput(Client* client, size_t bytes) {
+    if (client->failed) return false;
+    if (client->outputSize + bytes < client->outputCapacity) return true;
+    // Drop what has been sent before growing
+    if (client->outputSent > 0) {
+        memmove(client->output, client->output + client->outputSent, client->outputSize - client->outputSent);
+        client->outputSize -= client->outputSent;
+        client->outputSent = 0;
+        if (client->outputSize + bytes < client->outputCapacity) return true;
+    }
+    size_t capacity = client->outputCapacity ? client->outputCapacity : 4096;
+    while (capacity <= client->outputSize + bytes) capacity *= 2;
+    char* grown = realloc(client->output, capacity);
+    if (!grown) {
+        client->failed = true;
+        return false;
+    }
+    client->output = grown;
+    client->outputCapacity = capacity;
+    return true;
+}
+
+static void appendOutput(Client* client, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0 || !reserveOutput(client, (size_t)needed)) return;
+    va_start(args, format);
+    vsnprintf(client->output + client->outputSize, client->outputCapacity - client->outputSize, format, args);
+    va_end(args);
+    client->outputSize += needed;
+}
+
+static size_t pendingOutput(const Client* client) {
+    return client->outputSize - client->outputSent;
+}
+
+// Whether the client's next request can be answered now
+static bool answering(const Client* client) {
+    return !client->quit && !client->failed && !client->updating && pendingOutput(client) < SERVER_MAX_PENDING;
+}
+
+// Hands an ADD or REMOVE to the writer thread. The client's later requests
+// wait until the response is in.
+static void queueUpdate(Server* server, Client* client, bool add, const char** words, int count) {
+    size_t bytes = 0;
+    for (int i = 0; i < count; i++) bytes += strlen(words[i]) + 1;
+    Update* update = malloc(sizeof(Update) + count * sizeof(const char*) + bytes);
+    if (!update) {
+        appendOutput(client, "ERROR out of memory\n");
+        return;
+    }
+    char* text = (char*)(update->words + count);
+    for (int i = 0; i < count; i++) {
+        size_t length = strlen(words[i]) + 1;
+        memcpy(text, words[i], length);
+        update->words[i] = text;
+        text += length;
+    }
+    update->next = NULL;
+    update->client = client->id;
+    update->add = add;
+    update->count = count;
+    client->updating = true;
+    pthread_mutex_lock(&server->updateLock);
+    *server->queuedTail = update;
+    server->queuedTail = &update->next;
+    pthread_cond_signal(&server->updateQueued);
+    pthread_mutex_unlock(&server->updateLock);
+}
+
+// Answers one request line. Words never contain whitespace, so they are
+// echoed without quoting.
+static void handleRequest(Server* server, Client* client, char* line) {
+    char* save = NULL;
+    char* command = strtok_r(line, " \t", &save);
+    if (!command) return;  // Blank lines get no response
+    int count = 0;
+    for (char* word; (word = strtok_r(NULL, " \t", &save)) != NULL;) server->words[count++] = word;
+    const char** words = server->words;
+
+    if (strcmp(command, "CHECK") == 0 || strcmp(command, "SUGGEST") == 0) {
+        bool suggest = command[0] == 'S';
+        int k = server->options->maxSuggestions;
+        if (count < 1 || count > (suggest ? 2 : 1)) {
+            appendOutput(client, "ERROR usage: %s\n", suggest ? "SUGGEST word [k]" : "CHECK word");
+            return;
+        }
+        if (strlen(words[0]) > MAX_WORD_LENGTH) {
+            appendOutput(client, "ERROR word too long\n");
+            return;
+        }
+        if (count == 2) {
+            char* end;
+            long parsed = strtol(words[1], &end, 10);
+            if (*end != '\0' || parsed < 1 || parsed > SERVER_MAX_SUGGESTIONS) {
+                appendOutput(client, "ERROR k must be 1 to %d\n", SERVER_MAX_SUGGESTIONS);
+                return;
+            }
+            k = (int)parsed;
+        }
+        // The suggestions point into the snapshot, so it is held until
+        // they are copied out
+        const Dictionary* dict = beginDictionaryRead(server->shared, server->reader);
+        if (!suggest) {
+            appendOutput(client, "%s %s\n", searchWord(dict, words[0]) ? "FOUND" : "MISSING", words[0]);
+        } else {
+            Suggestion suggestions[SERVER_MAX_SUGGESTIONS];
+            int found = topSuggestions(dict, words[0], server->options->maxDistance, suggestions, k);
+            if (found < 0) {
+                appendOutput(client, "ERROR out of memory\n");
+            } else {
+                appendOutput(client, "SUGGESTIONS %s", words[0]);
+                for (int i = 0; i < found; i++) appendOutput(client, " %s", suggestions[i].word);
+                appendOutput(client, "\n");
+            }
+        }
+        endDictionaryRead(server->shared, server->reader);
+    } else if (strcmp(command, "ADD") == 0 || strcmp(command, "REMOVE") == 0) {
+        if (count < 1) {
+            appendOutput(client, "ERROR usage: %s word...\n", command);
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            if (strlen(words[i]) > MAX_WORD_LENGTH) {
+                appendOutput(client, "ERROR word too long\n");
+                return;
+            }
+        }
+        queueUpdate(server, client, command[0] == 'A', words, count);
+    } else if (strcmp(command, "SIZE") == 0) {
+        // The writer may retire the snapshot at any time, so read it as a reader
+        beginDictionaryRead(server->shared, server->reader);
+        appendOutput(client, "SIZE %u\n", concurrentDictionarySize(server->shared));
+        endDictionaryRead(server->shared, server->reader);
+    } else if (strcmp(command, "QUIT") == 0) {
+        client->quit = true;
+    } else {
+        appendOutput(client, "ERROR unknown command %.32s\n", command);
+    }
+}
+
+// Answers every complete line received so far, unless too many responses
+// are already waiting to be sent
+static void processInput(Server* server, Client* client) {
+    if (!client->input) return;
+    size_t start = 0;
+    while (answering(client)) {
+        char* newline = memchr(client->input + start, '\n', client->inputSize - start);
+        if (!newline) break;
+        if ((size_t)(newline - (client->input + start)) > SERVER_MAX_LINE) break;
+        *newline = '\0';
+        if (newline > client->input + start && newline[-1] == '\r') newline[-1] = '\0';
+        handleRequest(server, client, client->input + start);
+        start = (size_t)(newline - client->input) + 1;
+    }
+    if (start > 0) {
+        memmove(client->input, client->input + start, client->inputSize - start);
+        client->inputSize -= start;
+    }
+    // The next line, complete or not, is already over the limit
+    if (answering(client)) {
+        char* newline = client->inputSize ? memchr(client->input, '\n', client->inputSize) : NULL;
+        size_t length = newline ? (size_t)(newline - client->input) : client->inputSize;
+        if (length > SERVER_MAX_LINE) {
+            appendOutput(client, "ERROR line too long\n");
+            client->quit = true;
+        }
+    }
+}
+
+// Sends as much output as the socket takes, then resumes requests held
+// back by a full output buffer
+static void writeClient(Server* server, Client* client) {
+    while (!client->failed) {
+        while (!client->failed && pendingOutput(client) > 0) {
+            ssize_t sent = send(client->fd, client->output + client->outputSent, pendingOutput(client), MSG_NOSIGNAL);
+            if (sent > 0) client->outputSent += (size_t)sent;
+            else if (sent < 0 && errno == EINTR) continue;
+            else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            else client->failed = true;
+        }
+        client->outputSent = client->outputSize = 0;
+        processInput(server, client);
+        if (pendingOutput(client) == 0) return;
+    }
+}
+
+static void readClient(Server* server, Client* client) {
+    if (client->inputCapacity - client->inputSize < READ_SIZE + 1) {
+        size_t capacity = client->inputCapacity ? client->inputCapacity * 2 : 2 * READ_SIZE;
+        char* grown = realloc(client->input, capacity);
+        if (!grown) {
+            client->failed = true;
+            return;
+        }
+        client->input = grown;
+        client->inputCapacity = capacity;
+    }
+    ssize_t received = recv(client->fd, client->input + client->inputSize, READ_SIZE, 0);
+    if (received < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) client->failed = true;
+        return;
+    }
+    client->inputSize += (size_t)received;
+    if (received == 0) {
+        // End of requests; a last line without a newline still counts
+        client->peerClosed = true;
+        if (client->inputSize > 0 && client->input[client->inputSize - 1] != '\n') {
+            client->input[client->inputSize++] = '\n';
+        }
+    }
+    processInput(server, client);
+    writeClient(server, client);
+}
+
+// Finished once nothing more will be answered and everything is sent
+static bool clientDone(const Client* client) {
+    if (client->failed) return true;
+    if (client->updating || pendingOutput(client) > 0) return false;
+    return client->quit || (client->peerClosed && client->inputSize == 0);
+}
+
+static void closeClient(Client* client) {
+    close(client->fd);
+    free(client->input);
+    free(client->output);
+}
+
+static void acceptClients(Server* server, int listener) {
+    while (1) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            // EAGAIN, or out of descriptors: the rest wait in the backlog
+            return;
+        }
+        if (!setNonBlocking(fd)) {
+            close(fd);
+            continue;
+        }
+        if (server->clientCount == server->clientCapacity) {
+            int capacity = server->clientCapacity ? server->clientCapacity * 2 : 16;
+            Client* clients = realloc(server->clients, capacity * sizeof(Client));
+            if (clients) server->clients = clients;
+            struct pollfd* fds = realloc(server->fds, (capacity + 3) * sizeof(struct pollfd));
+            if (fds) server->fds = fds;
+            if (!clients || !fds) {
+                close(fd);
+                return;
+            }
+            server->clientCapacity = capacity;
+        }
+        Client* client = &server->clients[server->clientCount++];
+        memset(client, 0, sizeof(Client));
+        client->fd = fd;
+        client->id = server->nextClientId++;
+    }
+}
+
+// Runs queued updates one at a time until the server stops; updates still
+// queued then are dropped
+static void* runWriter(void* argument) {
+    Server* server = (Server*)argument;
+    pthread_mutex_lock(&server->updateLock);
+    while (1) {
+        while (!server->queued && !server->stopping) pthread_cond_wait(&server->updateQueued, &server->updateLock);
+        if (server->stopping) break;
+        Update* update = server->queued;
+        server->queued = update->next;
+        if (!server->queued) server->queuedTail = &server->queued;
+        pthread_mutex_unlock(&server->updateLock);
+
+        update->status = update->add ? updateConcurrentDictionary(server->shared, update->words, update->count, NULL, 0)
+                                     : updateConcurrentDictionary(server->shared, NULL, 0, update->words, update->count);
+        // Only this thread retires snapshots, so the current one stays valid
+        update->size = concurrentDictionarySize(server->shared);
+
+        pthread_mutex_lock(&server->updateLock);
+        update->next = NULL;
+        *server->doneTail = update;
+        server->doneTail = &update->next;
+        if (write(server->updatePipe[1], "", 1) < 0) {
+            // Pipe full: the loop is already due to wake
+        }
+    }
+    pthread_mutex_unlock(&server->updateLock);
+    return NULL;
+}
+
+// Answers the updates the writer has finished, then resumes the requests
+// their clients sent after them
+static void finishUpdates(Server* server) {
+    char drain[256];
+    while (read(server->updatePipe[0], drain, sizeof(drain)) > 0) {
+    }
+    pthread_mutex_lock(&server->updateLock);
+    Update* update = server->done;
+    server->done = NULL;
+    server->doneTail = &server->done;
+    pthread_mutex_unlock(&server->updateLock);
+
+    while (update) {
+        Update* next = update->next;
+        // The client may have gone in the meantime
+        for (int i = 0; i < server->clientCount; i++) {
+            Client* client = &server->clients[i];
+            if (client->id != update->client) continue;
+            client->updating = false;
+            if (update->status != 0) appendOutput(client, "ERROR out of memory\n");
+            else appendOutput(client, "OK %u\n", update->size);
+            processInput(server, client);
+            writeClient(server, client);
+            break;
+        }
+        free(update);
+        update = next;
+    }
+}
+
+static void freeUpdates(Update* update) {
+    while (update) {
+        Update* next = update->next;
+        free(update);
+        update = next;
+    }
+}
+
+// A socket file is only replaced if no daemon answers on it
+static bool staleSocket(const struct sockaddr_un* address) {
+    struct stat info;
+    if (lstat(address->sun_path, &info) != 0 || !S_ISSOCK(info.st_mode)) return false;
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) return false;
+    bool live = connect(probe, (const struct sockaddr*)address, sizeof(*address)) == 0;
+    close(probe);
+    return !live;
+}
+
+static int openListener(const char* path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+    if (bound != 0 && errno == EADDRINUSE && staleSocket(&address) && unlink(path) == 0) {
+        bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+    }
+    if (bound != 0 || listen(fd, SOMAXCONN) != 0 || !setNonBlocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int runServer(Dictionary* dict, const char* socketPath, const ServerOptions* options) {
+    if (pipe(stopPipe) != 0) return -1;
+    Server server;
+    memset(&server, 0, sizeof(server));
+    if (pipe(server.updatePipe) != 0) {
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+        return -1;
+    }
+    int listener = openListener(socketPath);
+    server.options = options;
+    server.shared = listener >= 0 ? createConcurrentDictionary(dict, 1) : NULL;
+    server.words = malloc((SERVER_MAX_LINE / 2 + 1) * sizeof(const char*));
+    server.fds = malloc(3 * sizeof(struct pollfd));
+    server.queuedTail = &server.queued;
+    server.doneTail = &server.done;
+    pthread_mutex_init(&server.updateLock, NULL);
+    pthread_cond_init(&server.updateQueued, NULL);
+    if (!server.shared || !server.words || !server.fds || !setNonBlocking(stopPipe[0]) ||
+        !setNonBlocking(stopPipe[1]) || !setNonBlocking(server.updatePipe[0]) ||
+        !setNonBlocking(server.updatePipe[1]) || pthread_create(&server.writer, NULL, runWriter, &server) != 0) {
+        if (listener >= 0) {
+            close(listener);
+            unlink(socketPath);
+        }
+        freeConcurrentDictionary(server.shared);
+        free(server.words);
+        free(server.fds);
+        pthread_mutex_destroy(&server.updateLock);
+        pthread_cond_destroy(&server.updateQueued);
+        close(server.updatePipe[0]);
+        close(server.updatePipe[1]);
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+        return -1;
+    }
+    server.reader = registerDictionaryReader(server.shared);
+    printf("Serving %u words on %s.\n", concurrentDictionarySize(server.shared), socketPath);
+    fflush(stdout);
+
+    struct sigaction action, oldInterrupt, oldTerminate;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &oldInterrupt);
+    sigaction(SIGTERM, &action, &oldTerminate);
+
+    while (1) {
+        struct pollfd* fds = server.fds;
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        fds[1].fd = stopPipe[0];
+        fds[1].events = POLLIN;
+        fds[2].fd = server.updatePipe[0];
+        fds[2].events = POLLIN;
+        for (int i = 0; i < server.clientCount; i++) {
+            const Client* client = &server.clients[i];
+            fds[i + 3].fd = client->fd;
+            fds[i + 3].events = 0;
+            // A client with a full output buffer, or waiting for an update,
+            // is not read from until it can be answered again (backpressure)
+            if (!client->quit && !client->peerClosed && !client->updating &&
+                pendingOutput(client) < SERVER_MAX_PENDING) {
+                fds[i + 3].events |= POLLIN;
+            }
+            if (pendingOutput(client) > 0) fds[i + 3].events |= POLLOUT;
+        }
+        int clientCount = server.clientCount;
+        if (poll(fds, clientCount + 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+
+        for (int i = 0; i < clientCount; i++) {
+            Client* client = &server.clients[i];
+            short revents = fds[i + 3].revents;
+            if ((fds[i + 3].events & POLLIN) && (revents & (POLLIN | POLLHUP | POLLERR))) {
+                readClient(&server, client);
+            } else if (revents & (POLLOUT | POLLERR)) {
+                writeClient(&server, client);
+            }
+        }
+        if (fds[2].revents & POLLIN) finishUpdates(&server);
+        // Drop finished clients, keeping the rest in order
+        int kept = 0;
+        for (int i = 0; i < server.clientCount; i++) {
+            if (clientDone(&server.clients[i])) closeClient(&server.clients[i]);
+            else server.clients[kept++] = server.clients[i];
+        }
+        server.clientCount = kept;
+        if (fds[0].revents & POLLIN) acceptClients(&server, listener);
+    }
+
+    sigaction(SIGINT, &oldInterrupt, NULL);
+    sigaction(SIGTERM, &oldTerminate, NULL);
+    // An update in progress finishes; the ones still queued are dropped
+    pthread_mutex_lock(&server.updateLock);
+    server.stopping = true;
+    pthread_cond_signal(&server.updateQueued);
+    pthread_mutex_unlock(&server.updateLock);
+    pthread_join(server.writer, NULL);
+    freeUpdates(server.queued);
+    freeUpdates(server.done);
+    pthread_mutex_destroy(&server.updateLock);
+    pthread_cond_destroy(&server.updateQueued);
+    close(server.updatePipe[0]);
+    close(server.updatePipe[1]);
+
+    for (int i = 0; i < server.clientCount; i++) closeClient(&server.clients[i]);
+    close(listener);
+    unlink(socketPath);
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    free(server.clients);
+    free(server.fds);
+    free(server.words);
+    freeConcurrentDictionary(server.shared);
+    return 0;
+}
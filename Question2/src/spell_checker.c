@@ -1,92 +1,687 @@
 #include "spell_checker.h"
+#include "bk_tree.h"
+#include "symspell.h"
+#include "dawg.h"
+#include "word_table.h"
+#include "dictionary_image.h"
 #include <ctype.h>
+#include <limits.h>
 
 // Define a macro for finding the minimum of three values
 #define MIN(a, b, c) ((a) < (b) ? ((a) < (c) ? (a) : (c)) : ((b) < (c) ? (b) : (c)))
 
-// Initialize an empty BST
-void initializeTree(TreeNode** root) {
-    *root = NULL;
+// FNV-1a over the word's bytes
+static uint32_t hashWord(const char* word, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)word[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Initialize an empty dictionary
+void initializeDictionary(Dictionary* dict) {
+    memset(dict, 0, sizeof(*dict));
+}
+
+// Index of the slot holding 'word', or of the empty slot where it belongs
+static uint32_t findSlot(const Dictionary* dict, const char* word, size_t length, uint32_t hash) {
+    uint32_t mask = dict->slotCount - 1;
+    uint32_t i = hash & mask;
+    while (dict->slots[i].word) {
+        uint32_t index = dict->slots[i].word - 1;
+        if (dict->slots[i].hash == hash && dict->lengths[index] == length &&
+            memcmp(dictionaryWord(dict, index), word, length) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Rebuild the hash table with 'slotCount' slots
+static bool resizeSlots(Dictionary* dict, uint32_t slotCount) {
+    HashSlot* slots = calloc(slotCount, sizeof(HashSlot));
+    if (!slots) return false;
+    uint32_t mask = slotCount - 1;
+    for (uint32_t s = 0; s < dict->slotCount; s++) {
+        if (!dict->slots[s].word) continue;
+        uint32_t i = dict->slots[s].hash & mask;
+        while (slots[i].word) i = (i + 1) & mask;
+        slots[i] = dict->slots[s];
+    }
+    free(dict->slots);
+    dict->slots = slots;
+    dict->slotCount = slotCount;
+    return true;
+}
+
+// Make room for 'words' more words and 'bytes' more pool bytes
+static bool reserveDictionary(Dictionary* dict, uint32_t words, size_t bytes) {
+    if (dict->count + words > dict->capacity) {
+        uint32_t capacity = dict->capacity ? dict->capacity : 64;
+        while (capacity < dict->count + words) capacity *= 2;
+        uint32_t* offsets = realloc(dict->offsets, capacity * sizeof(uint32_t));
+        if (!offsets) return false;
+        dict->offsets = offsets;
+        uint8_t* lengths = realloc(dict->lengths, capacity);
+        if (!lengths) return false;
+        dict->lengths = lengths;
+        if (dict->frequencies) {
+            uint32_t* frequencies = realloc(dict->frequencies, capacity * sizeof(uint32_t));
+            if (!frequencies) return false;
+            dict->frequencies = frequencies;
+        }
+        if (dict->removed) {
+            size_t oldBlocks = ((size_t)dict->capacity + 63) / 64;
+            size_t blocks = ((size_t)capacity + 63) / 64;
+            uint64_t* removed = realloc(dict->removed, blocks * sizeof(uint64_t));
+            if (!removed) return false;
+            memset(removed + oldBlocks, 0, (blocks - oldBlocks) * sizeof(uint64_t));
+            dict->removed = removed;
+        }
+        dict->capacity = capacity;
+    }
+    if (dict->poolSize + bytes > dict->poolCapacity) {
+        size_t capacity = dict->poolCapacity ? dict->poolCapacity : 1024;
+        while (capacity < dict->poolSize + bytes) capacity *= 2;
+        char* pool = realloc(dict->pool, capacity);
+        if (!pool) return false;
+        dict->pool = pool;
+        dict->poolCapacity = capacity;
+    }
+    // Keep the table at most half full
+    uint32_t slotCount = dict->slotCount ? dict->slotCount : 128;
+    while (slotCount < 2 * (dict->count + words)) slotCount *= 2;
+    if (slotCount != dict->slotCount) return resizeSlots(dict, slotCount);
+    return true;
+}
+
+static bool insertWordLength(Dictionary* dict, const char* word, size_t length) {
+    if (length == 0 || length > MAX_WORD_LENGTH) return false;
+    // A mapped image is read-only; copy it before the first change
+    if (dict->image && !detachDictionaryImage(dict)) return false;
+    if (!reserveDictionary(dict, 1, length + 1)) return false;
+
+    uint32_t hash = hashWord(word, length);
+    uint32_t slot = findSlot(dict, word, length, hash);
+    if (dict->slots[slot].word) return false;  // Duplicate words are ignored
+
+    uint32_t index = dict->count++;
+    dict->offsets[index] = (uint32_t)dict->poolSize;
+    dict->lengths[index] = (uint8_t)length;
+    if (dict->frequencies) dict->frequencies[index] = 0;
+    memcpy(dict->pool + dict->poolSize, word, length);
+    dict->pool[dict->poolSize + length] = '\0';
+    dict->poolSize += length + 1;
+    dict->slots[slot].hash = hash;
+    dict->slots[slot].word = index + 1;
+    // A tree without the word would hide it from suggestions; drop the tree
+    // and let findSuggestions scan instead
+    if (dict->bkTree && !bkTreeInsert(dict->bkTree, dict, index)) {
+        freeBkTree(dict->bkTree);
+        free(dict->bkTree);
+        dict->bkTree = NULL;
+    }
+    // Without room for the word, the fast path would miss it; drop it instead
+    if (dict->wordTable && length <= WORD_TABLE_TEXT && !wordTableInsert(dict->wordTable, word, length, index)) {
+        freeWordTable(dict->wordTable);
+        free(dict->wordTable);
+        dict->wordTable = NULL;
+    }
+    return true;
+}
+
+// Insert a word into the dictionary
+bool insertWord(Dictionary* dict, const char* word) {
+    return insertWordLength(dict, word, strlen(word));
+}
+
+// Empties slot 'i' and moves later entries of its probe run back into the
+// gap (backward-shift deletion), so every remaining word is still found
+// from its home slot
+static void deleteSlot(Dictionary* dict, uint32_t i) {
+    uint32_t mask = dict->slotCount - 1;
+    for (uint32_t j = (i + 1) & mask; dict->slots[j].word; j = (j + 1) & mask) {
+        // An entry whose home lies cyclically in (i, j] has to stay
+        uint32_t home = dict->slots[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            dict->slots[i] = dict->slots[j];
+            i = j;
+        }
+    }
+    dict->slots[i].hash = 0;
+    dict->slots[i].word = 0;
+}
+
+int removeWord(Dictionary* dict, const char* word) {
+    if (!searchWord(dict, word)) return 0;
+    if (dict->image && !detachDictionaryImage(dict)) return -1;
+    if (!dict->removed) {
+        dict->removed = calloc(((size_t)dict->capacity + 63) / 64, sizeof(uint64_t));
+        if (!dict->removed) return -1;
+    }
+    size_t length = strlen(word);
+    uint32_t slot = findSlot(dict, word, length, hashWord(word, length));
+    uint32_t index = dict->slots[slot].word - 1;
+    deleteSlot(dict, slot);
+    if (dict->wordTable && length <= WORD_TABLE_TEXT) wordTableRemove(dict->wordTable, word, length);
+    dict->removed[index / 64] |= 1ULL << (index % 64);
+    dict->removedCount++;
+    return 1;
 }
 
-// Insert a word into the BST
-void insertWord(TreeNode** root, const char* word) {
-    if (*root == NULL) {
-        *root = malloc(sizeof(TreeNode));
-        strcpy((*root)->word, word);
-        (*root)->left = (*root)->right = NULL;
-    } else if (strcmp(word, (*root)->word) < 0) {
-        insertWord(&(*root)->left, word);
-    } else if (strcmp(word, (*root)->word) > 0) {
-        insertWord(&(*root)->right, word);
+// Index of 'word', or -1 if it is not in the dictionary. Short words go
+// through the fast path when it is enabled.
+static long findWordIndex(const Dictionary* dict, const char* word, size_t length) {
+    if (dict->count == 0) return -1;
+    if (dict->wordTable && length > 0 && length <= WORD_TABLE_TEXT) {
+        return wordTableLookup(dict->wordTable, word, length);
     }
-    // Duplicate words are ignored
+    uint32_t slot = findSlot(dict, word, length, hashWord(word, length));
+    return dict->slots[slot].word ? (long)dict->slots[slot].word - 1 : -1;
 }
 
-// Search for a word in the BST
-bool searchWord(const TreeNode* root, const char* word) {
-    if (root == NULL) {
+// Search for a word in the dictionary: one hash and, normally, one probe
+bool searchWord(const Dictionary* dict, const char* word) {
+    return findWordIndex(dict, word, strlen(word)) >= 0;
+}
+
+void searchWords(const Dictionary* dict, const char* const* words, int count, bool* found) {
+    if (!dict->wordTable || dict->count == 0) {
+        for (int i = 0; i < count; i++) found[i] = searchWord(dict, words[i]);
+        return;
+    }
+    const char* batch[WORD_TABLE_BATCH];
+    size_t lengths[WORD_TABLE_BATCH];
+    int positions[WORD_TABLE_BATCH];
+    long indices[WORD_TABLE_BATCH];
+    int pending = 0;
+    for (int i = 0; i < count; i++) {
+        size_t length = strlen(words[i]);
+        if (length == 0 || length > WORD_TABLE_TEXT) {
+            found[i] = findWordIndex(dict, words[i], length) >= 0;
+        } else {
+            batch[pending] = words[i];
+            lengths[pending] = length;
+            positions[pending++] = i;
+        }
+        if (pending == WORD_TABLE_BATCH || (pending > 0 && i == count - 1)) {
+            wordTableLookupBatch(dict->wordTable, batch, lengths, pending, indices);
+            for (int j = 0; j < pending; j++) found[positions[j]] = indices[j] >= 0;
+            pending = 0;
+        }
+    }
+}
+
+bool enableFastLookup(Dictionary* dict, bool prefilter) {
+    WordTable* table = dict->wordTable ? dict->wordTable : malloc(sizeof(WordTable));
+    if (!table) return false;
+    if (!dict->wordTable) initializeWordTable(table);
+    if (!buildWordTable(table, dict, prefilter)) {
+        free(table);
+        dict->wordTable = NULL;
         return false;
     }
-    int cmp = strcmp(word, root->word);
-    if (cmp == 0) {
-        return true;
-    } else if (cmp < 0) {
-        return searchWord(root->left, word);
-    } else {
-        return searchWord(root->right, word);
+    dict->wordTable = table;
+    return true;
+}
+
+// Read the whole file at once and split it on whitespace, like fscanf("%s")
+int loadDictionary(Dictionary* dict, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    char magic[4];
+    if (fread(magic, 1, 4, file) == 4 && memcmp(magic, DICTIONARY_IMAGE_MAGIC, 4) == 0) {
+        fclose(file);
+        return mapDictionaryImage(dict, path);
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = size > 0 ? malloc((size_t)size) : NULL;
+    if (size < 0 || (size > 0 && (!text || fread(text, 1, (size_t)size, file) != (size_t)size))) {
+        free(text);
+        fclose(file);
+        return -1;
     }
+    fclose(file);
+
+    // An average English word is about 8 bytes with its separator
+    reserveDictionary(dict, (uint32_t)(size / 8), (size_t)size);
+
+    int words = 0;
+    long i = 0;
+    while (i < size) {
+        while (i < size && isspace((unsigned char)text[i])) i++;
+        long start = i;
+        while (i < size && !isspace((unsigned char)text[i])) i++;
+        if (i > start && insertWordLength(dict, text + start, (size_t)(i - start))) words++;
+    }
+    free(text);
+    return words;
 }
 
-// Suggest similar words based on Levenshtein Distance
-void suggestWords(const TreeNode* root, const char* word, int maxDistance) {
-    if (root == NULL) return;
+int loadFrequencies(Dictionary* dict, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+    if (dict->image && !detachDictionaryImage(dict)) {
+        fclose(file);
+        return -1;
+    }
+    if (!dict->frequencies) {
+        dict->frequencies = calloc(dict->capacity ? dict->capacity : 1, sizeof(uint32_t));
+        if (!dict->frequencies) {
+            fclose(file);
+            return -1;
+        }
+    }
 
-    // Calculate edit distance
-    int distance = levenshteinDistance(word, root->word); // Use the declared function
-    if (distance <= maxDistance) {
-        printf("Did you mean: %s\n", root->word);
+    char word[MAX_WORD_LENGTH + 1];
+    unsigned long frequency;
+    int pairs = 0;
+    while (fscanf(file, "%255s %lu", word, &frequency) == 2) {
+        size_t length = strlen(word);
+        long index = findWordIndex(dict, word, length);
+        if (index < 0) {
+            if (!insertWordLength(dict, word, length)) continue;
+            index = (long)dict->count - 1;
+        }
+        dict->frequencies[index] = frequency > UINT32_MAX ? UINT32_MAX : (uint32_t)frequency;
+        pairs++;
     }
+    fclose(file);
+    return pairs;
+}
 
-    // Traverse left and right subtrees
-    suggestWords(root->left, word, maxDistance);
-    suggestWords(root->right, word, maxDistance);
+bool setSuggestEngine(Dictionary* dict, SuggestEngine engine) {
+    if (engine == SUGGEST_BKTREE && !dict->bkTree) {
+        BkTree* tree = malloc(sizeof(BkTree));
+        if (!tree) return false;
+        initializeBkTree(tree);
+        if (!buildBkTree(tree, dict)) {
+            freeBkTree(tree);
+            free(tree);
+            return false;
+        }
+        dict->bkTree = tree;
+    }
+    if (engine == SUGGEST_SYMSPELL && !dict->symSpell) {
+        SymSpellIndex* index = malloc(sizeof(SymSpellIndex));
+        if (!index) return false;
+        initializeSymSpell(index);
+        if (!buildSymSpell(index, dict)) {
+            free(index);
+            return false;
+        }
+        dict->symSpell = index;
+    }
+    if (engine == SUGGEST_DAWG && !dict->dawg) {
+        Dawg* dawg = malloc(sizeof(Dawg));
+        if (!dawg) return false;
+        initializeDawg(dawg);
+        if (!buildDawg(dawg, dict)) {
+            free(dawg);
+            return false;
+        }
+        dict->dawg = dawg;
+    }
+    dict->engine = engine;
+    return true;
 }
 
-// Function to calculate Levenshtein Distance
-int levenshteinDistance(const char* str1, const char* str2) {
-    size_t len1 = strlen(str1);
-    size_t len2 = strlen(str2);
+// Dictionary index of a word pointer handed out by findSuggestions. Words
+// are appended to the pool, so offsets increase with the index.
+static uint32_t wordIndexAt(const Dictionary* dict, const char* word) {
+    uint32_t offset = (uint32_t)(word - dict->pool);
+    uint32_t low = 0;
+    uint32_t high = dict->count - 1;
+    while (low < high) {
+        uint32_t middle = low + (high - low + 1) / 2;
+        if (dict->offsets[middle] <= offset) low = middle;
+        else high = middle - 1;
+    }
+    return low;
+}
 
-    if (len1 == 0) return len2;
-    if (len2 == 0) return len1;
+// Wraps a callback to hold back removed words, which the indexes still hold
+typedef struct PresentWords {
+    const Dictionary* dict;
+    SuggestionCallback callback;
+    void* context;
+} PresentWords;
 
-    int matrix[len1 + 1][len2 + 1];
+static void reportPresentWord(const char* word, int distance, void* context) {
+    const PresentWords* present = (const PresentWords*)context;
+    if (!wordRemoved(present->dict, wordIndexAt(present->dict, word))) {
+        present->callback(word, distance, present->context);
+    }
+}
+
+bool findSuggestions(const Dictionary* dict, const char* word, int maxDistance,
+                     SuggestionCallback callback, void* context) {
+    PresentWords present = { dict, callback, context };
+    if (dict->removedCount > 0) {
+        callback = reportPresentWord;
+        context = &present;
+    }
+    if (dict->engine == SUGGEST_BKTREE && dict->bkTree) {
+        return bkTreeSearch(dict->bkTree, dict, word, maxDistance, callback, context);
+    }
+    uint32_t first = 0;
+    if (dict->engine == SUGGEST_SYMSPELL && dict->symSpell && maxDistance <= SYMSPELL_MAX_DISTANCE) {
+        // The index is not updated by insertWord; scan the words added since
+        if (!symSpellSearch(dict->symSpell, dict, word, maxDistance, callback, context)) return false;
+        first = dict->symSpell->wordCount;
+    }
+    if (dict->engine == SUGGEST_DAWG && dict->dawg) {
+        if (!dawgSearch(dict->dawg, dict, word, maxDistance, callback, context)) return false;
+        first = dict->dawg->wordCount;
+    }
+    // The words sit back to back in the pool, so the scan is sequential
+    size_t length = strlen(word);
+    for (uint32_t i = first; i < dict->count; i++) {
+        const char* candidate = dictionaryWord(dict, i);
+        int distance = boundedLevenshteinDistance(word, length, candidate, dict->lengths[i], maxDistance);
+        if (distance <= maxDistance) {
+            callback(candidate, distance, context);
+        }
+    }
+    return true;
+}
+
+// Bounded max-heap of the best suggestions so far; the root is the worst
+typedef struct TopSuggestions {
+    const Dictionary* dict;
+    Suggestion* heap;
+    int count;
+    int k;
+    int minDistance;        // Closer words were collected by an earlier round
+} TopSuggestions;
+
+// Whether 'a' ranks below 'b'; ties go alphabetically
+static bool rankedBelow(const Suggestion* a, const Suggestion* b) {
+    if (a->distance != b->distance) return a->distance > b->distance;
+    if (a->frequency != b->frequency) return a->frequency < b->frequency;
+    return strcmp(a->word, b->word) > 0;
+}
+
+static void siftDown(Suggestion* heap, int count, int i) {
+    while (1) {
+        int worst = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && rankedBelow(&heap[left], &heap[worst])) worst = left;
+        if (right < count && rankedBelow(&heap[right], &heap[worst])) worst = right;
+        if (worst == i) return;
+        Suggestion swap = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = swap;
+        i = worst;
+    }
+}
+
+static void offerSuggestion(const char* word, int distance, void* context) {
+    TopSuggestions* top = (TopSuggestions*)context;
+    if (distance < top->minDistance) return;
+    Suggestion candidate;
+    candidate.word = word;
+    candidate.distance = distance;
+    candidate.frequency = top->dict->frequencies ? top->dict->frequencies[wordIndexAt(top->dict, word)] : 0;
+
+    if (top->count < top->k) {
+        // Sift the new entry up to its place
+        int i = top->count++;
+        while (i > 0 && rankedBelow(&candidate, &top->heap[(i - 1) / 2])) {
+            top->heap[i] = top->heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        top->heap[i] = candidate;
+    } else if (rankedBelow(&top->heap[0], &candidate)) {
+        top->heap[0] = candidate;
+        siftDown(top->heap, top->count, 0);
+    }
+}
+
+int topSuggestions(const Dictionary* dict, const char* word, int maxDistance, Suggestion* results, int k) {
+    TopSuggestions top = { dict, results, 0, k, 0 };
+    if (k <= 0) return 0;
+
+    if (dict->engine == SUGGEST_SCAN) {
+        // One pass; once the heap is full, only words as close as its worst
+        // entry can still enter, which tightens the distance bound
+        size_t length = strlen(word);
+        for (uint32_t i = 0; i < dict->count; i++) {
+            if (wordRemoved(dict, i)) continue;
+            int bound = top.count == k ? top.heap[0].distance : maxDistance;
+            const char* candidate = dictionaryWord(dict, i);
+            int distance = boundedLevenshteinDistance(word, length, candidate, dict->lengths[i], bound);
+            if (distance <= bound) offerSuggestion(candidate, distance, &top);
+        }
+    } else {
+        // Search one distance at a time; when k words are known after
+        // distance d, every word not yet seen is farther and ranks lower
+        long exact = findWordIndex(dict, word, strlen(word));
+        if (exact >= 0) offerSuggestion(dictionaryWord(dict, (uint32_t)exact), 0, &top);
+        for (int distance = 1; distance <= maxDistance && top.count < k; distance++) {
+            top.minDistance = distance;
+            if (!findSuggestions(dict, word, distance, offerSuggestion, &top)) return -1;
+        }
+    }
+
+    // Heap sort: move the worst remaining entry to the back each time
+    for (int end = top.count - 1; end > 0; end--) {
+        Suggestion swap = results[0];
+        results[0] = results[end];
+        results[end] = swap;
+        siftDown(results, end, 0);
+    }
+    return top.count;
+}
+
+// Suggest similar words based on Levenshtein Distance
+void suggestWords(const Dictionary* dict, const char* word, int maxDistance) {
+    Suggestion results[MAX_SUGGESTIONS];
+    int count = topSuggestions(dict, word, maxDistance, results, MAX_SUGGESTIONS);
+    if (count < 0) printf("Error: Not enough memory for suggestions.\n");
+    for (int i = 0; i < count; i++) {
+        printf("Did you mean: %s\n", results[i].word);
+    }
+}
+
+// Myers/Hyyro bit-parallel edit distance for a pattern of at most 64
+// characters: bit i of the vertical delta vectors describes row i of the
+// current DP column, so each text character costs a handful of word
+// operations instead of a column of cells
+static int bitParallelDistance(const char* pattern, size_t patternLength,
+                               const char* text, size_t textLength, int maxDistance) {
+    uint64_t peq[256];
+    // Only the entries read below need clearing
+    for (size_t j = 0; j < textLength; j++) peq[(unsigned char)text[j]] = 0;
+    for (size_t i = 0; i < patternLength; i++) peq[(unsigned char)pattern[i]] = 0;
+    for (size_t i = 0; i < patternLength; i++) peq[(unsigned char)pattern[i]] |= 1ULL << i;
 
-    // Initialize matrix
-    for (size_t i = 0; i <= len1; i++) matrix[i][0] = i;
-    for (size_t j = 0; j <= len2; j++) matrix[0][j] = j;
+    uint64_t positive = ~0ULL;
+    uint64_t negative = 0;
+    uint64_t last = 1ULL << (patternLength - 1);
+    int score = (int)patternLength;
+    for (size_t j = 0; j < textLength; j++) {
+        uint64_t equal = peq[(unsigned char)text[j]];
+        uint64_t vertical = equal | negative;
+        uint64_t horizontal = (((equal & positive) + positive) ^ positive) | equal;
+        uint64_t horizontalPositive = negative | ~(horizontal | positive);
+        uint64_t horizontalNegative = positive & horizontal;
+        if (horizontalPositive & last) score++;
+        else if (horizontalNegative & last) score--;
+        // Row 0 grows by one per text character
+        horizontalPositive = (horizontalPositive << 1) | 1;
+        horizontalNegative <<= 1;
+        positive = horizontalNegative | ~(vertical | horizontalPositive);
+        negative = horizontalPositive & vertical;
+        // The score drops by at most one per remaining character
+        if (score - (int)(textLength - j - 1) > maxDistance) return maxDistance + 1;
+    }
+    return score <= maxDistance ? score : maxDistance + 1;
+}
+
+// Classic DP restricted to the diagonal band |i - j| <= maxDistance, two
+// rows at a time. Cells outside the band count as maxDistance + 1.
+static int bandedDistance(const char* str1, size_t len1, const char* str2, size_t len2, int maxDistance) {
+    int limit = maxDistance + 1;
+    int rowA[len2 + 1];
+    int rowB[len2 + 1];
+    int* previous = rowA;
+    int* current = rowB;
+    for (size_t j = 0; j <= len2; j++) previous[j] = j < (size_t)limit ? (int)j : limit;
 
-    // Compute distances
     for (size_t i = 1; i <= len1; i++) {
-        for (size_t j = 1; j <= len2; j++) {
+        size_t low = i > (size_t)maxDistance ? i - maxDistance : 1;
+        size_t high = i + maxDistance < len2 ? i + maxDistance : len2;
+        current[low - 1] = low == 1 && i < (size_t)limit ? (int)i : limit;
+        int rowMinimum = current[low - 1];
+        for (size_t j = low; j <= high; j++) {
             int cost = (str1[i - 1] == str2[j - 1]) ? 0 : 1;
-            matrix[i][j] = MIN(
-                matrix[i - 1][j] + 1,      // Deletion
-                matrix[i][j - 1] + 1,      // Insertion
-                matrix[i - 1][j - 1] + cost // Substitution
+            int value = MIN(
+                previous[j] + 1,            // Deletion
+                current[j - 1] + 1,         // Insertion
+                previous[j - 1] + cost      // Substitution
             );
+            current[j] = value < limit ? value : limit;
+            if (current[j] < rowMinimum) rowMinimum = current[j];
         }
+        if (high < len2) current[high + 1] = limit;
+        // Every later row starts from this one
+        if (rowMinimum > maxDistance) return limit;
+        int* swap = previous;
+        previous = current;
+        current = swap;
     }
+    return previous[len2];
+}
 
-    return matrix[len1][len2];
+// Edit distance if it is at most maxDistance, otherwise maxDistance + 1
+int boundedLevenshteinDistance(const char* str1, size_t len1, const char* str2, size_t len2, int maxDistance) {
+    size_t longest = len1 > len2 ? len1 : len2;
+    if ((size_t)maxDistance > longest) maxDistance = (int)longest;
+    size_t difference = len1 > len2 ? len1 - len2 : len2 - len1;
+    if (difference > (size_t)maxDistance) return maxDistance + 1;
+    if (len1 == 0 || len2 == 0) return (int)longest;
+
+    // The shorter word is the bit-parallel pattern
+    if (len1 <= len2 && len1 <= 64) return bitParallelDistance(str1, len1, str2, len2, maxDistance);
+    if (len2 <= 64) return bitParallelDistance(str2, len2, str1, len1, maxDistance);
+    return bandedDistance(str1, len1, str2, len2, maxDistance);
+}
+
+// Function to calculate Levenshtein Distance
+int levenshteinDistance(const char* str1, const char* str2) {
+    // No distance exceeds the longer length, so this bound is exact
+    return boundedLevenshteinDistance(str1, strlen(str1), str2, strlen(str2), INT_MAX);
+}
+
+static void* duplicateArray(const void* data, size_t size) {
+    void* copy = malloc(size ? size : 1);
+    if (copy && size) memcpy(copy, data, size);
+    return copy;
 }
 
-// Free memory allocated for the BST
-void freeTree(TreeNode* root) {
-    if (root != NULL) {
-        freeTree(root->left);
-        freeTree(root->right);
-        free(root);
+bool copyDictionary(Dictionary* copy, const Dictionary* dict) {
+    initializeDictionary(copy);
+    copy->engine = dict->engine;
+    copy->pool = duplicateArray(dict->pool, dict->poolSize);
+    copy->offsets = duplicateArray(dict->offsets, dict->count * sizeof(uint32_t));
+    copy->lengths = duplicateArray(dict->lengths, dict->count);
+    if (dict->frequencies) copy->frequencies = duplicateArray(dict->frequencies, dict->count * sizeof(uint32_t));
+    if (dict->removed) {
+        copy->removed = duplicateArray(dict->removed, ((size_t)dict->count + 63) / 64 * sizeof(uint64_t));
+    }
+    copy->slots = duplicateArray(dict->slots, dict->slotCount * sizeof(HashSlot));
+    if (dict->bkTree && (copy->bkTree = malloc(sizeof(BkTree))) != NULL &&
+        !copyBkTree(copy->bkTree, dict->bkTree)) {
+        free(copy->bkTree);
+        copy->bkTree = NULL;
+    }
+    if (dict->symSpell && (copy->symSpell = malloc(sizeof(SymSpellIndex))) != NULL &&
+        !copySymSpell(copy->symSpell, dict->symSpell)) {
+        free(copy->symSpell);
+        copy->symSpell = NULL;
+    }
+    if (dict->dawg && (copy->dawg = malloc(sizeof(Dawg))) != NULL && !copyDawg(copy->dawg, dict->dawg)) {
+        free(copy->dawg);
+        copy->dawg = NULL;
+    }
+    if (dict->wordTable && (copy->wordTable = malloc(sizeof(WordTable))) != NULL &&
+        !copyWordTable(copy->wordTable, dict->wordTable)) {
+        free(copy->wordTable);
+        copy->wordTable = NULL;
+    }
+    if (!copy->pool || !copy->offsets || !copy->lengths || (dict->frequencies && !copy->frequencies) ||
+        (dict->removed && !copy->removed) || !copy->slots || (dict->bkTree && !copy->bkTree) || (dict->symSpell && !copy->symSpell) ||
+        (dict->dawg && !copy->dawg) || (dict->wordTable && !copy->wordTable)) {
+        freeDictionary(copy);
+        return false;
+    }
+    copy->poolSize = dict->poolSize;
+    copy->poolCapacity = dict->poolSize;
+    copy->count = dict->count;
+    copy->capacity = dict->count;
+    copy->removedCount = dict->removedCount;
+    copy->slotCount = dict->slotCount;
+    return true;
+}
+
+size_t dictionaryMemory(const Dictionary* dict) {
+    size_t bytes = dict->poolCapacity + (size_t)dict->capacity * (sizeof(uint32_t) + sizeof(uint8_t)) +
+        (size_t)dict->slotCount * sizeof(HashSlot);
+    if (dict->frequencies) bytes += (size_t)dict->capacity * sizeof(uint32_t);
+    if (dict->removed) bytes += ((size_t)dict->capacity + 63) / 64 * sizeof(uint64_t);
+    if (dict->bkTree) bytes += bkTreeMemory(dict->bkTree);
+    if (dict->symSpell) bytes += symSpellMemory(dict->symSpell);
+    if (dict->dawg) bytes += dawgMemory(dict->dawg) + (size_t)dict->dawg->wordCount * sizeof(uint32_t);
+    if (dict->wordTable) bytes += wordTableMemory(dict->wordTable);
+    return bytes;
+}
+
+// Free memory allocated for the dictionary
+void freeDictionary(Dictionary* dict) {
+    if (dict->wordTable) {
+        freeWordTable(dict->wordTable);
+        free(dict->wordTable);
+        dict->wordTable = NULL;
+    }
+    if (dict->image) {
+        // The arrays live in the mapping, except those of an index built
+        // since; mapped indexes only have their headers allocated
+        if (dict->bkTree && !inDictionaryImage(dict, dict->bkTree->nodes)) freeBkTree(dict->bkTree);
+        if (dict->symSpell && !inDictionaryImage(dict, dict->symSpell->hashes)) freeSymSpell(dict->symSpell);
+        free(dict->bkTree);
+        free(dict->symSpell);
+        unmapDictionaryImage(dict);
+        if (dict->dawg) {
+            freeDawg(dict->dawg);
+            free(dict->dawg);
+        }
+        initializeDictionary(dict);
+        return;
+    }
+    if (dict->bkTree) {
+        freeBkTree(dict->bkTree);
+        free(dict->bkTree);
+    }
+    if (dict->symSpell) {
+        freeSymSpell(dict->symSpell);
+        free(dict->symSpell);
+    }
+    if (dict->dawg) {
+        freeDawg(dict->dawg);
+        free(dict->dawg);
     }
+    free(dict->pool);
+    free(dict->offsets);
+    free(dict->lengths);
+    free(dict->frequencies);
+    free(dict->removed);
+    free(dict->slots);
+    initializeDictionary(dict);
 }
@@ -0,0 +1,271 @@
+#include "symspell.h"
+
+// Most deletion strings one word can produce: 1 + P + P(P-1)/2
+#define MAX_DELETES (1 + SYMSPELL_PREFIX_LENGTH + SYMSPELL_PREFIX_LENGTH * (SYMSPELL_PREFIX_LENGTH - 1) / 2)
+
+typedef struct DeletePair {
+    uint64_t hash;
+    uint32_t word;
+} DeletePair;
+
+void initializeSymSpell(SymSpellIndex* index) {
+    memset(index, 0, sizeof(*index));
+}
+
+// FNV-1a, 64-bit
+static uint64_t hashBytes(const char* text, int length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int compareHashes(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static int compareIndices(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Hashes of the distinct strings left after deleting up to 'maxDeletes'
+// characters from the first SYMSPELL_PREFIX_LENGTH characters of 'word'
+static int collectDeletes(const char* word, int length, int maxDeletes, uint64_t hashes[MAX_DELETES]) {
+    int n = length < SYMSPELL_PREFIX_LENGTH ? length : SYMSPELL_PREFIX_LENGTH;
+    char buffer[SYMSPELL_PREFIX_LENGTH];
+    int count = 0;
+    hashes[count++] = hashBytes(word, n);
+
+    for (int i = 0; i < n && maxDeletes >= 1; i++) {
+        // Word without character i
+        memcpy(buffer, word, i);
+        memcpy(buffer + i, word + i + 1, n - i - 1);
+        hashes[count++] = hashBytes(buffer, n - 1);
+
+        for (int j = i + 1; j < n && maxDeletes >= 2; j++) {
+            // ... and without character j as well
+            memcpy(buffer, word, i);
+            memcpy(buffer + i, word + i + 1, j - i - 1);
+            memcpy(buffer + j - 1, word + j + 1, n - j - 1);
+            hashes[count++] = hashBytes(buffer, n - 2);
+        }
+    }
+
+    // Repeated letters give the same string from different positions
+    qsort(hashes, count, sizeof(uint64_t), compareHashes);
+    int unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (unique == 0 || hashes[i] != hashes[unique - 1]) hashes[unique++] = hashes[i];
+    }
+    return unique;
+}
+
+// Stable LSD radix sort on the hash, 16 bits per pass; pairs with equal
+// hashes keep their word order
+static bool sortPairs(DeletePair* pairs, size_t count) {
+    DeletePair* buffer = malloc((count ? count : 1) * sizeof(DeletePair));
+    size_t* offsets = malloc(65536 * sizeof(size_t));
+    if (!buffer || !offsets) {
+        free(buffer);
+        free(offsets);
+        return false;
+    }
+    DeletePair* from = pairs;
+    DeletePair* to = buffer;
+    for (int shift = 0; shift < 64; shift += 16) {
+        memset(offsets, 0, 65536 * sizeof(size_t));
+        for (size_t i = 0; i < count; i++) offsets[(from[i].hash >> shift) & 0xFFFF]++;
+        size_t total = 0;
+        for (int b = 0; b < 65536; b++) {
+            size_t n = offsets[b];
+            offsets[b] = total;
+            total += n;
+        }
+        for (size_t i = 0; i < count; i++) to[offsets[(from[i].hash >> shift) & 0xFFFF]++] = from[i];
+        DeletePair* swap = from;
+        from = to;
+        to = swap;
+    }
+    // Four passes leave the result back in 'pairs'
+    free(buffer);
+    free(offsets);
+    return true;
+}
+
+bool buildSymSpell(SymSpellIndex* index, const Dictionary* dict) {
+    freeSymSpell(index);
+    uint64_t hashes[MAX_DELETES];
+
+    // Count first so the pair array is allocated once
+    size_t pairCount = 0;
+    for (uint32_t w = 0; w < dict->count; w++) {
+        pairCount += collectDeletes(dictionaryWord(dict, w), dict->lengths[w], SYMSPELL_MAX_DISTANCE, hashes);
+    }
+    DeletePair* pairs = malloc((pairCount ? pairCount : 1) * sizeof(DeletePair));
+    if (!pairs) return false;
+    size_t filled = 0;
+    for (uint32_t w = 0; w < dict->count; w++) {
+        int n = collectDeletes(dictionaryWord(dict, w), dict->lengths[w], SYMSPELL_MAX_DISTANCE, hashes);
+        for (int i = 0; i < n; i++) {
+            pairs[filled].hash = hashes[i];
+            pairs[filled].word = w;
+            filled++;
+        }
+    }
+    if (!sortPairs(pairs, pairCount)) {
+        free(pairs);
+        return false;
+    }
+
+    uint32_t unique = 0;
+    for (size_t i = 0; i < pairCount; i++) {
+        if (i == 0 || pairs[i].hash != pairs[i - 1].hash) unique++;
+    }
+    int bits = 1;
+    while (bits < 24 && (1u << (bits + 1)) <= unique) bits++;
+
+    index->hashes = malloc((unique ? unique : 1) * sizeof(uint64_t));
+    index->starts = malloc((unique + 1) * sizeof(uint32_t));
+    index->postings = malloc((pairCount ? pairCount : 1) * sizeof(uint32_t));
+    index->directory = malloc(((1u << bits) + 1) * sizeof(uint32_t));
+    if (!index->hashes || !index->starts || !index->postings || !index->directory) {
+        free(pairs);
+        freeSymSpell(index);
+        return false;
+    }
+
+    uint32_t h = 0;
+    for (size_t i = 0; i < pairCount; i++) {
+        if (i == 0 || pairs[i].hash != pairs[i - 1].hash) {
+            index->hashes[h] = pairs[i].hash;
+            index->starts[h] = (uint32_t)i;
+            h++;
+        }
+        index->postings[i] = pairs[i].word;
+    }
+    index->starts[unique] = (uint32_t)pairCount;
+    free(pairs);
+
+    // directory[b] is the first hash whose top bits are >= b
+    uint32_t position = 0;
+    for (uint32_t b = 0; b <= (1u << bits); b++) {
+        while (position < unique && (index->hashes[position] >> (64 - bits)) < b) position++;
+        index->directory[b] = position;
+    }
+    index->hashCount = unique;
+    index->directoryBits = bits;
+    index->wordCount = dict->count;
+    return true;
+}
+
+// Posting range of 'hash', empty if it is not in the index
+static void findPostings(const SymSpellIndex* index, uint64_t hash, uint32_t* first, uint32_t* last) {
+    uint64_t bucket = hash >> (64 - index->directoryBits);
+    uint32_t low = index->directory[bucket];
+    uint32_t high = index->directory[bucket + 1];
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (index->hashes[middle] < hash) low = middle + 1;
+        else high = middle;
+    }
+    if (low < index->hashCount && index->hashes[low] == hash) {
+        *first = index->starts[low];
+        *last = index->starts[low + 1];
+    } else {
+        *first = *last = 0;
+    }
+}
+
+bool symSpellSearch(const SymSpellIndex* index, const Dictionary* dict, const char* word, int maxDistance,
+                    SuggestionCallback callback, void* context) {
+    if (index->hashCount == 0) return true;
+    if (maxDistance > SYMSPELL_MAX_DISTANCE) maxDistance = SYMSPELL_MAX_DISTANCE;
+    int length = (int)strlen(word);
+    uint64_t hashes[MAX_DELETES];
+    int deleteCount = collectDeletes(word, length, maxDistance, hashes);
+
+    // Gather candidates from every matching deletion, then drop repeats
+    uint32_t localCandidates[1024];
+    uint32_t* candidates = localCandidates;
+    size_t candidateCapacity = 1024;
+    size_t candidateCount = 0;
+    for (int d = 0; d < deleteCount; d++) {
+        uint32_t first, last;
+        findPostings(index, hashes[d], &first, &last);
+        for (uint32_t p = first; p < last; p++) {
+            uint32_t candidate = index->postings[p];
+            int lengthDifference = (int)dict->lengths[candidate] - length;
+            if (lengthDifference > maxDistance || -lengthDifference > maxDistance) continue;
+            if (candidateCount == candidateCapacity) {
+                uint32_t* grown = malloc(2 * candidateCapacity * sizeof(uint32_t));
+                if (!grown) {
+                    if (candidates != localCandidates) free(candidates);
+                    return false;
+                }
+                memcpy(grown, candidates, candidateCount * sizeof(uint32_t));
+                if (candidates != localCandidates) free(candidates);
+                candidates = grown;
+                candidateCapacity *= 2;
+            }
+            candidates[candidateCount++] = candidate;
+        }
+    }
+    qsort(candidates, candidateCount, sizeof(uint32_t), compareIndices);
+
+    for (size_t i = 0; i < candidateCount; i++) {
+        if (i > 0 && candidates[i] == candidates[i - 1]) continue;
+        const char* candidate = dictionaryWord(dict, candidates[i]);
+        int distance = boundedLevenshteinDistance(word, length, candidate, dict->lengths[candidates[i]], maxDistance);
+        if (distance <= maxDistance) {
+            callback(candidate, distance, context);
+        }
+    }
+    if (candidates != localCandidates) free(candidates);
+    return true;
+}
+
+size_t symSpellMemory(const SymSpellIndex* index) {
+    if (!index->starts) return 0;
+    return (size_t)index->hashCount * sizeof(uint64_t) + (index->hashCount + 1) * sizeof(uint32_t) +
+        (size_t)index->starts[index->hashCount] * sizeof(uint32_t) +
+        ((1u << index->directoryBits) + 1) * sizeof(uint32_t);
+}
+
+bool copySymSpell(SymSpellIndex* copy, const SymSpellIndex* index) {
+    initializeSymSpell(copy);
+    if (!index->starts) return true;
+    size_t hashesSize = index->hashCount * sizeof(uint64_t);
+    size_t startsSize = (index->hashCount + 1) * sizeof(uint32_t);
+    size_t postingsSize = index->starts[index->hashCount] * sizeof(uint32_t);
+    size_t directorySize = ((1u << index->directoryBits) + 1) * sizeof(uint32_t);
+    copy->hashes = malloc(hashesSize ? hashesSize : 1);
+    copy->starts = malloc(startsSize);
+    copy->postings = malloc(postingsSize ? postingsSize : 1);
+    copy->directory = malloc(directorySize);
+    if (!copy->hashes || !copy->starts || !copy->postings || !copy->directory) {
+        freeSymSpell(copy);
+        return false;
+    }
+    memcpy(copy->hashes, index->hashes, hashesSize);
+    memcpy(copy->starts, index->starts, startsSize);
+    memcpy(copy->postings, index->postings, postingsSize);
+    memcpy(copy->directory, index->directory, directorySize);
+    copy->hashCount = index->hashCount;
+    copy->directoryBits = index->directoryBits;
+    copy->wordCount = index->wordCount;
+    return true;
+}
+
+void freeSymSpell(SymSpellIndex* index) {
+    free(index->hashes);
+    free(index->starts);
+    free(index->postings);
+    free(index->directory);
+    initializeSymSpell(index);
+}
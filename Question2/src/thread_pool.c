@@ -0,0 +1,126 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+struct ThreadPool {
+    pthread_t* workers;
+    int workerCount;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // A new job was posted or the pool is shutting down
+    pthread_cond_t done;        // The last item of the current job finished
+    unsigned long generation;   // Incremented for every posted job
+    int shutdown;
+
+    PoolTask task;
+    void* context;
+    size_t count;
+    size_t next;                // Next item to hand out
+    size_t finished;
+    int failed;
+};
+
+// Claim and run items of the current job until none are left
+static void drainTasks(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->next < pool->count) {
+        size_t index = pool->next++;
+        PoolTask task = pool->task;
+        void* context = pool->context;
+        pthread_mutex_unlock(&pool->lock);
+
+        int result = task(context, index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (result != 0) pool->failed = 1;
+        if (++pool->finished == pool->count) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void* workerMain(void* arg) {
+    ThreadPool* pool = (ThreadPool*)arg;
+    pthread_mutex_lock(&pool->lock);
+    unsigned long seen = pool->generation;
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        drainTasks(pool);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool* createThreadPool(int threads) {
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    if (threads < 1) threads = 1;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->workers = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    if (!pool->workers) {
+        freeThreadPool(pool);
+        return NULL;
+    }
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&pool->workers[i], NULL, workerMain, pool) != 0) break;
+        pool->workerCount++;
+    }
+    return pool;
+}
+
+int runThreadPool(ThreadPool* pool, size_t count, PoolTask task, void* context) {
+    if (count == 0) return 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    pool->next = 0;
+    pool->finished = 0;
+    pool->failed = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    // The calling thread works on the job as well
+    drainTasks(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->finished < pool->count) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    int failed = pool->failed;
+    pthread_mutex_unlock(&pool->lock);
+    return failed ? -1 : 0;
+}
+
+void freeThreadPool(ThreadPool* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->workerCount; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+int defaultThreadCount(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
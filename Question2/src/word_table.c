@@ -0,0 +1,296 @@
+#include "word_table.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define WORD_TABLE_X86
+#endif
+
+// Bits set per word in its Bloom block
+#define BLOOM_PROBES 6
+// Compare-mask bits covering a slot's text
+#define TEXT_MASK ((1u << WORD_TABLE_TEXT) - 1)
+
+static WordKernel selectKernel(void) {
+#ifdef WORD_TABLE_X86
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2")) return WORD_KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return WORD_KERNEL_SSE42;
+#endif
+    return WORD_KERNEL_PORTABLE;
+}
+
+// Zero-padded copy of a query, laid out like a slot
+static void makeKey(WordSlot* key, const char* word, size_t length) {
+    memset(key, 0, sizeof(*key));
+    memcpy(key->text, word, length);
+}
+
+static void loadLanes(const WordSlot* key, uint64_t lanes[4]) {
+    lanes[3] = 0;
+    memcpy(lanes, key->text, WORD_TABLE_TEXT);
+}
+
+// Portable hash: each 8-byte lane multiplied by its own odd constant, then
+// folded
+static uint32_t mixHash(const WordSlot* key) {
+    uint64_t lanes[4];
+    loadLanes(key, lanes);
+    uint64_t hash = lanes[0] * 0x9E3779B97F4A7C15ULL ^ lanes[1] * 0xC2B2AE3D27D4EB4FULL ^
+        lanes[2] * 0x165667B19E3779F9ULL ^ lanes[3] * 0x27D4EB2F165667C5ULL;
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+#ifdef WORD_TABLE_X86
+// Hardware CRC32C over the padded text: four instructions for any word
+__attribute__((target("sse4.2")))
+static uint32_t crcHash(const WordSlot* key) {
+    uint64_t lanes[4];
+    loadLanes(key, lanes);
+    uint64_t hash = 0xFFFFFFFFu;
+    hash = _mm_crc32_u64(hash, lanes[0]);
+    hash = _mm_crc32_u64(hash, lanes[1]);
+    hash = _mm_crc32_u64(hash, lanes[2]);
+    return _mm_crc32_u32((uint32_t)hash, (uint32_t)lanes[3]);
+}
+#endif
+
+static uint32_t hashKey(const WordTable* table, const WordSlot* key) {
+#ifdef WORD_TABLE_X86
+    if (table->kernel != WORD_KERNEL_PORTABLE) return crcHash(key);
+#endif
+    return mixHash(key);
+}
+
+// The slot index uses the low hash bits; the block and the bit positions
+// come from the high bits of two products
+static uint64_t* bloomBlock(const WordTable* table, uint32_t hash) {
+    uint32_t block = (uint32_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ULL) >> 40) & (table->bloomBlocks - 1);
+    return table->bloom + 8 * (size_t)block;
+}
+
+static uint64_t bloomBits(uint32_t hash) {
+    uint64_t bits = (uint64_t)hash * 0xC2B2AE3D27D4EB4FULL;
+    return bits ^ (bits >> 31);
+}
+
+static void bloomAdd(WordTable* table, uint32_t hash) {
+    uint64_t* block = bloomBlock(table, hash);
+    uint64_t bits = bloomBits(hash);
+    for (int i = 0; i < BLOOM_PROBES; i++, bits >>= 9) {
+        block[(bits >> 6) & 7] |= 1ULL << (bits & 63);
+    }
+}
+
+static bool bloomMayContain(const WordTable* table, uint32_t hash) {
+    const uint64_t* block = bloomBlock(table, hash);
+    uint64_t bits = bloomBits(hash);
+    for (int i = 0; i < BLOOM_PROBES; i++, bits >>= 9) {
+        if (!(block[(bits >> 6) & 7] & (1ULL << (bits & 63)))) return false;
+    }
+    return true;
+}
+
+void initializeWordTable(WordTable* table) {
+    memset(table, 0, sizeof(*table));
+    table->kernel = selectKernel();
+}
+
+// Empty arrays for 'slotCount' slots; the prefilter gets one block per 64
+// slots (8 bits per slot)
+static bool allocateWordTable(WordTable* table, uint32_t slotCount, bool prefilter) {
+    table->slots = aligned_alloc(64, (size_t)slotCount * sizeof(WordSlot));
+    if (!table->slots) return false;
+    memset(table->slots, 0, (size_t)slotCount * sizeof(WordSlot));
+    table->slotCount = slotCount;
+    table->count = 0;
+    if (prefilter) {
+        table->bloomBlocks = slotCount >= 64 ? slotCount / 64 : 1;
+        table->bloom = aligned_alloc(64, (size_t)table->bloomBlocks * 64);
+        if (!table->bloom) {
+            free(table->slots);
+            table->slots = NULL;
+            return false;
+        }
+        memset(table->bloom, 0, (size_t)table->bloomBlocks * 64);
+    }
+    return true;
+}
+
+// Stores a slot whose word is known to be absent
+static void placeSlot(WordTable* table, const WordSlot* slot) {
+    uint32_t hash = hashKey(table, slot);
+    uint32_t mask = table->slotCount - 1;
+    uint32_t i = hash & mask;
+    while (table->slots[i].word) i = (i + 1) & mask;
+    table->slots[i] = *slot;
+    if (table->bloom) bloomAdd(table, hash);
+    table->count++;
+}
+
+static bool resizeWordTable(WordTable* table, uint32_t slotCount) {
+    WordTable resized;
+    initializeWordTable(&resized);
+    resized.kernel = table->kernel;
+    if (!allocateWordTable(&resized, slotCount, table->bloom != NULL)) return false;
+    for (uint32_t i = 0; i < table->slotCount; i++) {
+        if (table->slots[i].word) placeSlot(&resized, &table->slots[i]);
+    }
+    free(table->slots);
+    free(table->bloom);
+    *table = resized;
+    return true;
+}
+
+bool buildWordTable(WordTable* table, const Dictionary* dict, bool prefilter) {
+    WordKernel kernel = table->kernel;
+    freeWordTable(table);
+    table->kernel = kernel;
+    uint32_t shortWords = 0;
+    for (uint32_t i = 0; i < dict->count; i++) {
+        if (dict->lengths[i] <= WORD_TABLE_TEXT && !wordRemoved(dict, i)) shortWords++;
+    }
+    uint32_t slotCount = 64;
+    while ((uint64_t)slotCount * 3 < (uint64_t)shortWords * 4) slotCount *= 2;
+    if (!allocateWordTable(table, slotCount, prefilter)) return false;
+    for (uint32_t i = 0; i < dict->count; i++) {
+        if (dict->lengths[i] > WORD_TABLE_TEXT || wordRemoved(dict, i)) continue;
+        WordSlot slot;
+        makeKey(&slot, dictionaryWord(dict, i), dict->lengths[i]);
+        slot.word = i + 1;
+        placeSlot(table, &slot);
+    }
+    return true;
+}
+
+bool wordTableInsert(WordTable* table, const char* word, size_t length, uint32_t index) {
+    // Keep the table at most 3/4 full
+    if (((uint64_t)table->count + 1) * 4 > (uint64_t)table->slotCount * 3 &&
+        !resizeWordTable(table, table->slotCount ? table->slotCount * 2 : 64)) {
+        return false;
+    }
+    WordSlot slot;
+    makeKey(&slot, word, length);
+    slot.word = index + 1;
+    placeSlot(table, &slot);
+    return true;
+}
+
+bool wordTableRemove(WordTable* table, const char* word, size_t length) {
+    if (table->count == 0) return false;
+    WordSlot key;
+    makeKey(&key, word, length);
+    uint32_t mask = table->slotCount - 1;
+    uint32_t i = hashKey(table, &key) & mask;
+    while (table->slots[i].word && memcmp(table->slots[i].text, key.text, WORD_TABLE_TEXT) != 0) i = (i + 1) & mask;
+    if (!table->slots[i].word) return false;
+    // Backward-shift deletion: move later entries of the probe run into the
+    // gap unless their home slot lies cyclically in (i, j]
+    for (uint32_t j = (i + 1) & mask; table->slots[j].word; j = (j + 1) & mask) {
+        uint32_t home = hashKey(table, &table->slots[j]) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            table->slots[i] = table->slots[j];
+            i = j;
+        }
+    }
+    memset(&table->slots[i], 0, sizeof(WordSlot));
+    table->count--;
+    return true;
+}
+
+static long lookupPortable(const WordTable* table, const WordSlot* key, uint32_t hash) {
+    uint32_t mask = table->slotCount - 1;
+    for (uint32_t i = hash & mask; table->slots[i].word; i = (i + 1) & mask) {
+        if (memcmp(table->slots[i].text, key->text, WORD_TABLE_TEXT) == 0) return (long)table->slots[i].word - 1;
+    }
+    return -1;
+}
+
+#ifdef WORD_TABLE_X86
+// Two 16-byte compares per slot; SSE2 is part of x86-64
+static long lookupSse2(const WordTable* table, const WordSlot* key, uint32_t hash) {
+    const __m128i low = _mm_load_si128((const __m128i*)key);
+    const __m128i high = _mm_load_si128((const __m128i*)key + 1);
+    uint32_t mask = table->slotCount - 1;
+    for (uint32_t i = hash & mask; table->slots[i].word; i = (i + 1) & mask) {
+        const __m128i* slot = (const __m128i*)&table->slots[i];
+        uint32_t equal = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(slot), low)) |
+            (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(slot + 1), high)) << 16;
+        if ((equal & TEXT_MASK) == TEXT_MASK) return (long)table->slots[i].word - 1;
+    }
+    return -1;
+}
+
+// One 32-byte compare per slot
+__attribute__((target("avx2")))
+static long lookupAvx2(const WordTable* table, const WordSlot* key, uint32_t hash) {
+    const __m256i query = _mm256_load_si256((const __m256i*)key);
+    uint32_t mask = table->slotCount - 1;
+    for (uint32_t i = hash & mask; table->slots[i].word; i = (i + 1) & mask) {
+        __m256i slot = _mm256_load_si256((const __m256i*)&table->slots[i]);
+        uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(slot, query));
+        if ((equal & TEXT_MASK) == TEXT_MASK) return (long)table->slots[i].word - 1;
+    }
+    return -1;
+}
+#endif
+
+// Checks the prefilter, then probes with the table's kernel
+static long probe(const WordTable* table, const WordSlot* key, uint32_t hash) {
+    if (table->bloom && !bloomMayContain(table, hash)) return -1;
+    switch (table->kernel) {
+#ifdef WORD_TABLE_X86
+        case WORD_KERNEL_AVX2:
+            return lookupAvx2(table, key, hash);
+        case WORD_KERNEL_SSE42:
+            return lookupSse2(table, key, hash);
+#endif
+        default:
+            return lookupPortable(table, key, hash);
+    }
+}
+
+long wordTableLookup(const WordTable* table, const char* word, size_t length) {
+    if (table->count == 0) return -1;
+    WordSlot key;
+    makeKey(&key, word, length);
+    return probe(table, &key, hashKey(table, &key));
+}
+
+void wordTableLookupBatch(const WordTable* table, const char* const* words, const size_t* lengths, int count,
+                          long* results) {
+    WordSlot keys[WORD_TABLE_BATCH];
+    uint32_t hashes[WORD_TABLE_BATCH];
+    if (table->count == 0) {
+        for (int i = 0; i < count; i++) results[i] = -1;
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        makeKey(&keys[i], words[i], lengths[i]);
+        hashes[i] = hashKey(table, &keys[i]);
+        if (table->bloom) __builtin_prefetch(bloomBlock(table, hashes[i]));
+        __builtin_prefetch(&table->slots[hashes[i] & (table->slotCount - 1)]);
+    }
+    for (int i = 0; i < count; i++) results[i] = probe(table, &keys[i], hashes[i]);
+}
+
+size_t wordTableMemory(const WordTable* table) {
+    return (size_t)table->slotCount * sizeof(WordSlot) + (table->bloom ? (size_t)table->bloomBlocks * 64 : 0);
+}
+
+bool copyWordTable(WordTable* copy, const WordTable* table) {
+    initializeWordTable(copy);
+    copy->kernel = table->kernel;
+    if (!table->slots) return true;
+    if (!allocateWordTable(copy, table->slotCount, table->bloom != NULL)) return false;
+    memcpy(copy->slots, table->slots, (size_t)table->slotCount * sizeof(WordSlot));
+    if (table->bloom) memcpy(copy->bloom, table->bloom, (size_t)table->bloomBlocks * 64);
+    copy->count = table->count;
+    return true;
+}
+
+void freeWordTable(WordTable* table) {
+    free(table->slots);
+    free(table->bloom);
+    initializeWordTable(table);
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "concurrent_dictionary.h"
+
+// Concurrency stress test for the shared dictionary: reader threads check
+// words and ask for suggestions on snapshots while a writer keeps adding
+// and removing batches of words, once per suggestion engine. Prints one
+// CSV line per engine with the read throughput and the update latencies.
+// Exits non-zero if a reader ever sees a snapshot that no single update
+// could have produced.
+
+// Suggestions asked for per query
+#define STRESS_SUGGESTIONS 5
+
+typedef struct EngineInfo {
+    const char* name;
+    SuggestEngine engine;
+} EngineInfo;
+
+static const EngineInfo engines[] = {
+    {"scan", SUGGEST_SCAN},
+    {"bktree", SUGGEST_BKTREE},
+    {"symspell", SUGGEST_SYMSPELL},
+    {"dawg", SUGGEST_DAWG},
+};
+
+// State shared by the writer and the readers of one run. Update r adds
+// batch r and removes batch r - 2, so every snapshot holds the base words
+// plus zero, one or two whole batches.
+typedef struct StressRun {
+    ConcurrentDictionary* shared;
+    const Dictionary* base;     // The words every snapshot must hold
+    int batchSize;
+    _Atomic int published;      // Last update that returned, -1 before the first
+    _Atomic bool stop;
+    _Atomic long violations;
+} StressRun;
+
+typedef struct StressReader {
+    StressRun* run;
+    pthread_t thread;
+    uint64_t seed;
+    long reads;
+} StressReader;
+
+// xorshift64*: fixed seeds keep the words identical from run to run
+static uint64_t nextRandom(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Four to ten lowercase letters
+static void generateLetters(char* word, uint64_t* seed) {
+    int length = 4 + (int)(nextRandom(seed) % 7);
+    for (int i = 0; i < length; i++) word[i] = (char)('a' + nextRandom(seed) % 26);
+    word[length] = '\0';
+}
+
+// Word 'i' of batch 'round'. The digits keep it apart from the base words
+// and from every other batch.
+static void batchWord(char* word, int round, int i) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL ^ ((uint64_t)round << 20 | (uint64_t)i);
+    nextRandom(&seed);
+    generateLetters(word, &seed);
+    sprintf(word + strlen(word), "%d_%d", round, i);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void reportViolation(StressRun* run, const char* what, const char* word) {
+    if (atomic_fetch_add(&run->violations, 1) == 0) {
+        fprintf(stderr, "Inconsistent snapshot: %s (%s)\n", what, word);
+    }
+}
+
+// Checks one snapshot: its size, a base word, which words of a past batch
+// it holds, and that no suggestion is a word it does not hold
+static void checkSnapshot(StressRun* run, const Dictionary* dict, int published, uint64_t* seed) {
+    uint32_t batchWords = dict->count - dict->removedCount - run->base->count;
+    if (batchWords != 0 && batchWords != (uint32_t)run->batchSize && batchWords != 2 * (uint32_t)run->batchSize) {
+        reportViolation(run, "size is not the base words plus whole batches", "");
+    }
+
+    Suggestion results[STRESS_SUGGESTIONS];
+    const char* word = dictionaryWord(run->base, (uint32_t)(nextRandom(seed) % run->base->count));
+    int count = topSuggestions(dict, word, 1, results, STRESS_SUGGESTIONS);
+    if (!searchWord(dict, word)) reportViolation(run, "base word missing", word);
+    if (count < 1 || results[0].distance != 0 || strcmp(results[0].word, word) != 0) {
+        reportViolation(run, "base word not suggested first", word);
+    }
+    if (published < 0) return;
+
+    // A batch that an update before the last one already removed must be
+    // gone; a later one is there in full or not at all
+    char batch[MAX_WORD_LENGTH + 1];
+    int round = (int)(nextRandom(seed) % (uint64_t)(published + 1));
+    int present = 0;
+    for (int i = 0; i < run->batchSize; i++) {
+        batchWord(batch, round, i);
+        present += searchWord(dict, batch);
+    }
+    if (present != 0 && (round < published - 1 || present != run->batchSize)) {
+        batchWord(batch, round, 0);
+        reportViolation(run, "batch partly present or not removed", batch);
+    }
+
+    // One edit away from a batch word, which therefore comes up if present
+    batchWord(batch, round, (int)(nextRandom(seed) % (uint64_t)run->batchSize));
+    strcat(batch, "z");
+    count = topSuggestions(dict, batch, 1, results, STRESS_SUGGESTIONS);
+    if (count < 0) reportViolation(run, "out of memory", batch);
+    for (int i = 0; i < count; i++) {
+        if (!searchWord(dict, results[i].word)) reportViolation(run, "suggested a removed word", results[i].word);
+    }
+}
+
+static void* runReader(void* argument) {
+    StressReader* reader = (StressReader*)argument;
+    StressRun* run = reader->run;
+    int slot = registerDictionaryReader(run->shared);
+    while (!atomic_load(&run->stop)) {
+        // Read before the snapshot is taken, so the snapshot is at least as new
+        int published = atomic_load(&run->published);
+        const Dictionary* dict = beginDictionaryRead(run->shared, slot);
+        checkSnapshot(run, dict, published, &reader->seed);
+        endDictionaryRead(run->shared, slot);
+        reader->reads++;
+    }
+    return NULL;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double* sorted, int count, double fraction) {
+    int rank = (int)(fraction * count + 0.999999);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [-n words] [-r readers] [-u updates] [-b batch] [engine...]\n", program);
+    printf("Engines: scan bktree symspell dawg (default: all)\n");
+    printf("-n base words (default 50000), -r reader threads (default 4), -u updates (default 500),\n");
+    printf("-b words added and removed per update (default 16)\n");
+}
+
+int main(int argc, char* argv[]) {
+    long wordCount = 50000;
+    int readerCount = 4;
+    int updateCount = 500;
+    int batchSize = 16;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:u:b:")) != -1) {
+        switch (opt) {
+            case 'n':
+                wordCount = atol(optarg);
+                break;
+            case 'r':
+                readerCount = atoi(optarg);
+                break;
+            case 'u':
+                updateCount = atoi(optarg);
+                break;
+            case 'b':
+                batchSize = atoi(optarg);
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (wordCount < 1) wordCount = 1;
+    if (readerCount < 1) readerCount = 1;
+    if (updateCount < 1) updateCount = 1;
+    if (batchSize < 1) batchSize = 1;
+    const int engineCount = (int)(sizeof(engines) / sizeof(engines[0]));
+    for (int i = optind; i < argc; i++) {
+        int e = 0;
+        while (e < engineCount && strcmp(argv[i], engines[e].name) != 0) e++;
+        if (e == engineCount) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    Dictionary base;
+    initializeDictionary(&base);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL + (uint64_t)wordCount;
+    char word[MAX_WORD_LENGTH + 1];
+    while ((long)base.count < wordCount) {
+        generateLetters(word, &seed);
+        if (!insertWord(&base, word) && !searchWord(&base, word)) break;
+    }
+    StressReader* readers = malloc(readerCount * sizeof(StressReader));
+    double* latencies = malloc(updateCount * sizeof(double));
+    char* batches = malloc((size_t)3 * batchSize * (MAX_WORD_LENGTH + 1));
+    const char** add = malloc(batchSize * sizeof(const char*));
+    const char** remove = malloc(batchSize * sizeof(const char*));
+    if ((long)base.count < wordCount || !readers || !latencies || !batches || !add || !remove) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+
+    printf("engine,words,readers,updates,batch,reads_per_sec,update_p50_ms,update_p99_ms,update_max_ms,violations\n");
+    long failures = 0;
+    for (int e = 0; e < engineCount; e++) {
+        bool selected = optind == argc;
+        for (int i = optind; i < argc; i++) selected |= strcmp(argv[i], engines[e].name) == 0;
+        if (!selected) continue;
+
+        Dictionary initial;
+        if (!copyDictionary(&initial, &base) || !setSuggestEngine(&initial, engines[e].engine) ||
+            !enableFastLookup(&initial, true)) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return 1;
+        }
+        StressRun run;
+        run.shared = createConcurrentDictionary(&initial, readerCount);
+        run.base = &base;
+        run.batchSize = batchSize;
+        atomic_init(&run.published, -1);
+        atomic_init(&run.stop, false);
+        atomic_init(&run.violations, 0);
+        if (!run.shared) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return 1;
+        }
+        int started = 0;
+        for (; started < readerCount; started++) {
+            readers[started].run = &run;
+            readers[started].seed = 0x2545F4914F6CDD1DULL + (uint64_t)started;
+            readers[started].reads = 0;
+            if (pthread_create(&readers[started].thread, NULL, runReader, &readers[started]) != 0) break;
+        }
+
+        // Batch r lives in row r % 3 of 'batches' until update r + 2 removes it
+        double start = now();
+        for (int r = 0; r < updateCount; r++) {
+            char* row = batches + (size_t)(r % 3) * batchSize * (MAX_WORD_LENGTH + 1);
+            char* removed = batches + (size_t)((r + 1) % 3) * batchSize * (MAX_WORD_LENGTH + 1);
+            for (int i = 0; i < batchSize; i++) {
+                batchWord(row + (size_t)i * (MAX_WORD_LENGTH + 1), r, i);
+                add[i] = row + (size_t)i * (MAX_WORD_LENGTH + 1);
+                remove[i] = removed + (size_t)i * (MAX_WORD_LENGTH + 1);
+            }
+            double updateStart = now();
+            if (updateConcurrentDictionary(run.shared, add, batchSize, remove, r >= 2 ? batchSize : 0) != 0) {
+                reportViolation(&run, "update failed", add[0]);
+            }
+            latencies[r] = (now() - updateStart) * 1e3;
+            atomic_store(&run.published, r);
+        }
+        atomic_store(&run.stop, true);
+        long reads = 0;
+        for (int i = 0; i < started; i++) {
+            pthread_join(readers[i].thread, NULL);
+            reads += readers[i].reads;
+        }
+        double elapsed = now() - start;
+        if (started < readerCount) reportViolation(&run, "cannot start a reader thread", "");
+
+        qsort(latencies, updateCount, sizeof(double), compareDoubles);
+        long violations = atomic_load(&run.violations);
+        printf("%s,%u,%d,%d,%d,%.0f,%.3f,%.3f,%.3f,%ld\n", engines[e].name, base.count, started, updateCount,
+               batchSize, reads / elapsed, percentile(latencies, updateCount, 0.5),
+               percentile(latencies, updateCount, 0.99), latencies[updateCount - 1], violations);
+        fflush(stdout);
+        failures += violations;
+        freeConcurrentDictionary(run.shared);
+    }
+
+    free(readers);
+    free(latencies);
+    free(batches);
+    free(add);
+    free(remove);
+    freeDictionary(&base);
+    return failures > 0 ? 1 : 0;
+}
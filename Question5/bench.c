@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "huffman.h"
+
+// Throughput benchmark: generates synthetic corpora in memory, runs them
+// through the buffer API and reports one record per corpus as CSV or JSON
+// lines. Exits non-zero if any round trip does not reproduce its input.
+
+typedef void (*CorpusGenerator)(unsigned char* data, size_t size, uint64_t* seed);
+
+typedef struct Corpus {
+    const char* name;
+    CorpusGenerator generate;
+} Corpus;
+
+// xorshift64*: fixed seeds keep the corpora identical from run to run
+static uint64_t nextRandom(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Every value of a 64-symbol alphabet equally likely
+static void generateUniform(unsigned char* data, size_t size, uint64_t* seed) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (unsigned char)('0' + (nextRandom(seed) & 63));
+    }
+}
+
+// Geometric distribution: symbol k appears about twice as often as k + 1
+static void generateSkewed(unsigned char* data, size_t size, uint64_t* seed) {
+    for (size_t i = 0; i < size; i++) {
+        uint64_t bits = nextRandom(seed) | (1ULL << 20);
+        data[i] = (unsigned char)('a' + __builtin_ctzll(bits));
+    }
+}
+
+// Words drawn with Zipf-like weights, separated by spaces and line breaks
+static void generateText(unsigned char* data, size_t size, uint64_t* seed) {
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "is", "that", "for", "it", "with",
+        "as", "was", "on", "be", "by", "this", "are", "from", "or", "an",
+        "huffman", "compression", "block", "symbol", "frequency", "table",
+        "decoder", "encoder", "stream", "length", "canonical", "entropy"
+    };
+    const int wordCount = (int)(sizeof(words) / sizeof(words[0]));
+    size_t i = 0;
+    while (i < size) {
+        // Squaring a uniform value favours the low indices
+        uint64_t r = nextRandom(seed) % 1024;
+        const char* word = words[(r * r * wordCount) >> 20];
+        for (const char* c = word; *c && i < size; c++) data[i++] = (unsigned char)*c;
+        if (i < size) data[i++] = (nextRandom(seed) % 12 == 0) ? '\n' : ' ';
+    }
+}
+
+static void generateSingle(unsigned char* data, size_t size, uint64_t* seed) {
+    (void)seed;
+    memset(data, 'a', size);
+}
+
+static void generateIncompressible(unsigned char* data, size_t size, uint64_t* seed) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (unsigned char)nextRandom(seed);
+    }
+}
+
+static const Corpus corpora[] = {
+    {"uniform", generateUniform},
+    {"skewed", generateSkewed},
+    {"text", generateText},
+    {"single", generateSingle},
+    {"incompressible", generateIncompressible},
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// High-water mark of the whole process so far, not of one corpus
+static long peakRssKib(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void printUsage(const char* program) {
+    printf("Usage: %s [-m size_mib] [-r repeats] [-t threads] [-b block_kib] [-s 1|4] [-c huffman|fse|auto] [-j] [corpus...]\n", program);
+    printf("Corpora: uniform skewed text single incompressible (default: all)\n");
+    printf("-j prints JSON lines instead of CSV\n");
+}
+
+int main(int argc, char* argv[]) {
+    HuffmanOptions options = {HUFF_DEFAULT_BLOCK_SIZE, 0, 1, HUFF_CODER_HUFFMAN};
+    size_t size = 16 << 20;
+    int repeats = 5;
+    int json = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:r:t:b:s:c:j")) != -1) {
+        switch (opt) {
+            case 'm':
+                size = (size_t)(strtod(optarg, NULL) * (1 << 20));
+                break;
+            case 'r':
+                repeats = atoi(optarg);
+                break;
+            case 't':
+                options.threads = atoi(optarg);
+                break;
+            case 'b':
+                options.blockSize = (size_t)strtoul(optarg, NULL, 10) * 1024;
+                break;
+            case 's':
+                options.streams = atoi(optarg);
+                break;
+            case 'c':
+                if (strcmp(optarg, "huffman") == 0) options.coder = HUFF_CODER_HUFFMAN;
+                else if (strcmp(optarg, "fse") == 0) options.coder = HUFF_CODER_FSE;
+                else if (strcmp(optarg, "auto") == 0) options.coder = HUFF_CODER_AUTO;
+                else {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'j':
+                json = 1;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (repeats < 1) repeats = 1;
+    const int corpusCount = (int)(sizeof(corpora) / sizeof(corpora[0]));
+    for (int i = optind; i < argc; i++) {
+        int known = 0;
+        for (int c = 0; c < corpusCount; c++) {
+            if (strcmp(argv[i], corpora[c].name) == 0) known = 1;
+        }
+        if (!known) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    HuffmanContext* ctx = createHuffmanContext(&options);
+    size_t capacity = huffmanCompressBound(size);
+    unsigned char* original = (unsigned char*)malloc(size ? size : 1);
+    unsigned char* compressed = (unsigned char*)malloc(capacity);
+    unsigned char* restored = (unsigned char*)malloc(size ? size : 1);
+    if (!ctx || !original || !compressed || !restored) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+
+    if (!json) {
+        printf("corpus,size,compressed,ratio,compress_mbps,decompress_mbps,process_peak_rss_kib,roundtrip\n");
+    }
+
+    int failures = 0;
+    for (int c = 0; c < corpusCount; c++) {
+        const Corpus* corpus = &corpora[c];
+        if (optind < argc) {
+            int selected = 0;
+            for (int i = optind; i < argc; i++) {
+                if (strcmp(argv[i], corpus->name) == 0) selected = 1;
+            }
+            if (!selected) continue;
+        }
+
+        uint64_t seed = 0x9E3779B97F4A7C15ULL + c;
+        corpus->generate(original, size, &seed);
+
+        // Best of 'repeats' runs, verifying every round trip
+        double compressTime = 0, decompressTime = 0;
+        size_t compressedSize = 0, restoredSize = 0;
+        int ok = 1;
+        for (int r = 0; r < repeats && ok; r++) {
+            double start = now();
+            ok = huffmanCompress(ctx, original, size, compressed, capacity, &compressedSize) == 0;
+            double middle = now();
+            ok = ok && huffmanDecompress(ctx, compressed, compressedSize, restored, size, &restoredSize) == 0;
+            double end = now();
+            ok = ok && restoredSize == size && memcmp(original, restored, size) == 0;
+            if (r == 0 || middle - start < compressTime) compressTime = middle - start;
+            if (r == 0 || end - middle < decompressTime) decompressTime = end - middle;
+        }
+        if (!ok) failures++;
+
+        double megabytes = size / 1e6;
+        double ratio = size ? (double)compressedSize / size : 0;
+        double compressRate = compressTime > 0 ? megabytes / compressTime : 0;
+        double decompressRate = decompressTime > 0 ? megabytes / decompressTime : 0;
+        if (json) {
+            printf("{\"corpus\":\"%s\",\"size\":%zu,\"compressed\":%zu,\"ratio\":%.4f,"
+                   "\"compress_mbps\":%.1f,\"decompress_mbps\":%.1f,\"process_peak_rss_kib\":%ld,\"roundtrip\":%s}\n",
+                   corpus->name, size, compressedSize, ratio, compressRate, decompressRate,
+                   peakRssKib(), ok ? "true" : "false");
+        } else {
+            printf("%s,%zu,%zu,%.4f,%.1f,%.1f,%ld,%s\n", corpus->name, size, compressedSize, ratio,
+                   compressRate, decompressRate, peakRssKib(), ok ? "ok" : "FAIL");
+        }
+        fflush(stdout);
+    }
+
+    freeHuffmanContext(ctx);
+    free(original);
+    free(compressed);
+    free(restored);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#ifndef FSE_H
+#define FSE_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Table-based asymmetric numeral systems (tANS), the "finite state
+// entropy" coder. Symbols are coded with fractional bit costs from a
+// 2^FSE_TABLE_LOG-state table, so skewed blocks get close to their entropy
+// while decoding remains one table lookup and one bit read per symbol.
+#define FSE_TABLE_LOG   11
+#define FSE_TABLE_SIZE  (1 << FSE_TABLE_LOG)
+
+// Encoded payload layout:
+//   header    : last used symbol (1), then one count per symbol 0..last -
+//               1 byte below 128, otherwise 2 bytes (0x80 | high, low)
+//   bitstream : written back to front and closed by a 1 sentinel bit, so
+//               the decoder starts reading at the last byte
+// The counts are normalized to sum to FSE_TABLE_SIZE.
+
+// Scales 'freq' (summing to 'total') to counts that sum to FSE_TABLE_SIZE,
+// keeping every used symbol at least 1. Returns -1 if 'total' is 0.
+int fseNormalizeCounts(const uint64_t freq[256], uint64_t total, short norm[256]);
+// Predicted payload size in bytes for data with histogram 'freq'
+size_t fseEstimateSize(const uint64_t freq[256], const short norm[256]);
+// Encodes 'src' into 'dst'. Returns the payload size, or 0 if it does not
+// fit in 'capacity' bytes.
+size_t fseCompress(const unsigned char* src, size_t srcSize, const short norm[256],
+                   unsigned char* dst, size_t capacity);
+// Decodes exactly 'dstSize' bytes. Returns 0, or -1 for corrupt input.
+int fseDecompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize);
+
+#endif
@@ -1,33 +1,176 @@
 #ifndef HUFFMAN_H
 #define HUFFMAN_H
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
+// Number of bits resolved by the first-level decode lookup
+#define HUFF_TABLE_BITS 11
+// Longest code the canonical format emits; equal to HUFF_TABLE_BITS so a
+// canonical table is a single 2^11-entry lookup that stays in L1
+#define HUFF_MAX_CODE_LENGTH HUFF_TABLE_BITS
+
+// Format markers. The first byte of a file selects the file format; each
+// block inside a HUFF_FORMAT_BLOCKS container starts with the marker of
+// the coder used for that block.
+#define HUFF_FORMAT_LEGACY      0x00    // Frequency table header, tree-ordered codes
+#define HUFF_FORMAT_CANONICAL   0x01    // Canonical code lengths + one bitstream
+#define HUFF_FORMAT_BLOCKS      0x02    // Block container with a block index
+#define HUFF_FORMAT_HUFFMAN_X4  0x03    // Canonical code lengths + four interleaved bitstreams
+#define HUFF_FORMAT_FSE         0x04    // tANS/FSE normalized counts + one bitstream (see fse.h)
+#define HUFF_FORMAT_RLE         0xFE    // Block of a single repeated byte
+#define HUFF_FORMAT_STORED      0xFF    // Raw copy
+#define HUFF_BLOCK_END          0x00    // Terminates the block sequence
+
+// Container layout:
+//   header  : marker (1), block size (4)
+//   blocks  : type (1), raw size (4), payload size (4), payload
+//   end     : HUFF_BLOCK_END header with zero sizes
+//   index   : per block - header offset (8), raw size (4), stored size (4)
+//   footer  : index offset (8), block count (8), original size (8), magic (4)
+// All integers are little-endian.
+#define HUFF_CONTAINER_HEADER_SIZE  5
+#define HUFF_BLOCK_HEADER_SIZE      9
+#define HUFF_INDEX_ENTRY_SIZE       16
+#define HUFF_FOOTER_SIZE            28
+#define HUFF_FOOTER_MAGIC           "HUFI"
+
+#define HUFF_DEFAULT_BLOCK_SIZE (256 * 1024)
+#define HUFF_MIN_BLOCK_SIZE     1024
+#define HUFF_MAX_BLOCK_SIZE     (64 * 1024 * 1024)
+// Four-stream blocks: the payload holds the code lengths, a jump table with
+// the byte sizes of streams 0-2, then the streams. Stream k encodes bytes
+// [k * q, (k + 1) * q) of the block with q = ceil(size / 4).
+#define HUFF_X4_JUMP_TABLE_SIZE 12
+#define HUFF_X4_MIN_BLOCK_SIZE  256
+
+// Alignment of the large I/O buffers used when a file cannot be mapped
+#define HUFF_IO_ALIGNMENT       4096
+// Worst-case encoded size of a block, including 8 bytes of slack for the
+// bit writer's word-sized stores
+#define HUFF_BLOCK_BOUND(size) (HUFF_BLOCK_HEADER_SIZE + (size) + 8)
+
+// Entropy coder choice per block. Blocks that do not shrink are always
+// stored, and single-value blocks always use HUFF_FORMAT_RLE.
+#define HUFF_CODER_HUFFMAN  0   // Canonical Huffman
+#define HUFF_CODER_FSE      1   // tANS/FSE
+#define HUFF_CODER_AUTO     2   // Whichever of the two is smaller
+
+typedef struct HuffmanOptions {
+    size_t blockSize;   // Input bytes per block
+    int threads;        // Worker threads, 0 for one per online CPU
+    int streams;        // Bitstreams per Huffman block: 1, or 4 for interleaved decoding
+    int coder;          // HUFF_CODER_*
+} HuffmanOptions;
+
+typedef struct BlockIndexEntry {
+    uint64_t offset;        // File offset of the block header
+    uint32_t rawSize;
+    uint32_t storedSize;    // Header plus payload
+} BlockIndexEntry;
+
+// A Huffman tree over at most 256 symbols has at most 511 nodes, so the
+// whole tree lives in one fixed array and children are array indices.
+#define HUFF_MAX_TREE_NODES 511
+
 typedef struct Node {
+    uint64_t frequency;
+    short left;             // Child indices, -1 for a leaf
+    short right;
     unsigned char data;
-    int frequency;
-    struct Node* left;
-    struct Node* right;
 } Node;
 
+typedef struct HuffmanTree {
+    Node nodes[HUFF_MAX_TREE_NODES];
+    int count;
+    int root;               // -1 for an empty tree
+} HuffmanTree;
+
 typedef struct MinHeap {
-    Node** array;
+    short array[256];       // Indices into HuffmanTree.nodes
     int size;
-    int capacity;
 } MinHeap;
 
-Node* createNode(unsigned char data, int frequency);
-MinHeap* createMinHeap(int capacity);
-void minHeapify(MinHeap* heap, int idx);
-Node* extractMin(MinHeap* heap);
-void insertMinHeap(MinHeap* heap, Node* node);
-Node* buildHuffmanTree(int freq[], int size);
-void writeBits(FILE* file, unsigned int bits, int numBits);
-void flushBits(FILE* file);
-void generateCodes(Node* node, unsigned int code, unsigned char len, unsigned int codes[], unsigned char codeLengths[]);
-void freeHuffmanTree(Node* root);
-int compressFile(const char* inputFile);
-int decompressFile(const char* inputFile);
+// One slot of a decode lookup table. A leaf entry decodes 'value' after
+// consuming 'length' bits; a link entry (subBits != 0) consumes 'length'
+// bits and continues in the subtable of width 'subBits' at index 'value'.
+typedef struct DecodeEntry {
+    unsigned int value;
+    unsigned char length;
+    unsigned char subBits;
+} DecodeEntry;
+
+typedef struct DecodeTable {
+    DecodeEntry* entries;   // Root table first, followed by subtables
+    int rootBits;
+    int size;
+    int capacity;
+} DecodeTable;
+
+// Packs codes MSB-first into a 64-bit register and drains whole bytes into
+// the output buffer with word-sized stores. Each store needs 8 bytes of
+// room; a drain without it writes nothing and sets 'overflow'.
+typedef struct BitWriter {
+    unsigned char* buffer;
+    size_t size;
+    size_t capacity;
+    uint64_t bits;      // Pending bits, left-aligned
+    int count;          // Number of pending bits
+    bool overflow;      // Output was dropped for lack of room
+} BitWriter;
+
+void minHeapify(MinHeap* heap, const Node nodes[], int idx);
+int extractMin(MinHeap* heap, const Node nodes[]);
+void insertMinHeap(MinHeap* heap, const Node nodes[], int node);
+// Counts every byte value of 'data' into freq[0..255]
+void countFrequencies(const unsigned char* data, size_t size, uint64_t freq[256]);
+// Builds the tree into 'tree' without allocating; returns the root index,
+// or -1 if every frequency is zero
+int buildHuffmanTree(HuffmanTree* tree, const uint64_t freq[], int size);
+void initBitWriter(BitWriter* writer, unsigned char* buffer, size_t capacity);
+void writeBits(BitWriter* writer, unsigned int bits, int numBits);
+// Returns the number of bytes written; check 'overflow' before using them
+size_t flushBits(BitWriter* writer);
+void generateCodes(const HuffmanTree* tree, int node, unsigned int code, unsigned char len,
+                   unsigned int codes[], unsigned char codeLengths[]);
+void limitCodeLengths(unsigned char codeLengths[256], const uint64_t freq[256], int maxLength);
+int assignCanonicalCodes(const unsigned char codeLengths[256], unsigned int codes[256]);
+int buildCanonicalDecodeTable(const unsigned char codeLengths[256], DecodeTable* table);
+int buildDecodeTable(const HuffmanTree* tree, DecodeTable* table);
+void freeDecodeTable(DecodeTable* table);
+size_t compressBlock(const unsigned char* src, size_t srcSize, unsigned char* dst,
+                     const HuffmanOptions* options);
+int decompressBlock(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize);
+// File front ends. A path of "-" selects stdin/stdout; a NULL output path
+// keeps the historical compressed.txt / decompressed.txt names.
+int compressFile(const char* inputFile, const char* outputFile, const HuffmanOptions* options);
+int decompressFile(const char* inputFile, const char* outputFile, const HuffmanOptions* options);
+// Writes bytes [offset, offset + length) of the original data, decoding
+// only the blocks of the container that overlap the range
+int decompressRange(const char* inputFile, const char* outputFile, uint64_t offset, uint64_t length,
+                    const HuffmanOptions* options);
+// Buffer-to-buffer API. A context owns its worker threads and scratch
+// memory; one context serves one call at a time, and separate contexts may
+// be used concurrently. These functions never print and return 0 on
+// success or -1 on failure (invalid data, or 'dstCapacity' too small).
+// Compressed buffers use the same block container as compressFile, so
+// either side can read what the other wrote.
+typedef struct HuffmanContext HuffmanContext;
+
+HuffmanContext* createHuffmanContext(const HuffmanOptions* options);
+void freeHuffmanContext(HuffmanContext* ctx);
+// Largest compressed size of 'srcSize' bytes with any block size
+size_t huffmanCompressBound(size_t srcSize);
+int huffmanCompress(HuffmanContext* ctx, const unsigned char* src, size_t srcSize,
+                    unsigned char* dst, size_t dstCapacity, size_t* dstSize);
+// Reads the original size from a compressed buffer without decoding it
+int huffmanDecompressedSize(const unsigned char* src, size_t srcSize, uint64_t* size);
+int huffmanDecompress(HuffmanContext* ctx, const unsigned char* src, size_t srcSize,
+                      unsigned char* dst, size_t dstCapacity, size_t* dstSize);
+// Decodes 'length' bytes starting at original offset 'offset' into 'dst'
+int huffmanDecompressRange(HuffmanContext* ctx, const unsigned char* src, size_t srcSize,
+                           uint64_t offset, size_t length, unsigned char* dst);
+
 void calculateFileSize(const char* fileName, long* size);
 
 #endif
@@ -1,19 +1,78 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "huffman.h"
 
+static void printUsage(const char* program) {
+    printf("Usage: %s [-t threads] [-b block_kib] [-s 1|4] [-c coder] [-o output_file] <compress/decompress> <input_file>\n", program);
+    printf("-s 4 splits every block into four interleaved bitstreams for faster decoding\n");
+    printf("-c selects the entropy coder: huffman (default), fse, or auto for the smaller per block\n");
+    printf("       %s [-t threads] [-o output_file] extract <compressed_file> <offset> <length>\n", program);
+    printf("Use '-' as input or output file to read stdin or write stdout\n");
+    printf("extract decodes only the blocks holding bytes [offset, offset + length)\n");
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        printf("Usage: %s <compress/decompress> <input_file>\n", argv[0]);
+    HuffmanOptions options = {HUFF_DEFAULT_BLOCK_SIZE, 0, 1, HUFF_CODER_HUFFMAN};
+    const char* outputFile = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:s:c:o:")) != -1) {
+        switch (opt) {
+            case 't':
+                options.threads = atoi(optarg);
+                break;
+            case 'b':
+                options.blockSize = (size_t)strtoul(optarg, NULL, 10) * 1024;
+                break;
+            case 's':
+                options.streams = atoi(optarg);
+                break;
+            case 'c':
+                if (strcmp(optarg, "huffman") == 0) options.coder = HUFF_CODER_HUFFMAN;
+                else if (strcmp(optarg, "fse") == 0) options.coder = HUFF_CODER_FSE;
+                else if (strcmp(optarg, "auto") == 0) options.coder = HUFF_CODER_AUTO;
+                else {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'o':
+                outputFile = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (argc - optind < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const char* command = argv[optind];
+    const char* inputFile = argv[optind + 1];
+
+    if (strcmp(command, "extract") == 0) {
+        if (argc - optind != 4) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        uint64_t offset = strtoull(argv[optind + 2], NULL, 10);
+        uint64_t length = strtoull(argv[optind + 3], NULL, 10);
+        return decompressRange(inputFile, outputFile, offset, length, &options) == 0 ? 0 : 1;
+    }
+    if (argc - optind != 2) {
+        printUsage(argv[0]);
         return 1;
     }
     
-    if (strcmp(argv[1], "compress") == 0) {
-        if (compressFile(argv[2]) == 0) {
+    if (strcmp(command, "compress") == 0) {
+        if (compressFile(inputFile, outputFile, &options) == 0) {
             return 0;
         }
-    } else if (strcmp(argv[1], "decompress") == 0) {
-        if (decompressFile(argv[2]) == 0) {
+    } else if (strcmp(command, "decompress") == 0) {
+        if (decompressFile(inputFile, outputFile, &options) == 0) {
             return 0;
         }
     } else {
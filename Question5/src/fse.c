@@ -0,0 +1,371 @@
+#include <string.h>
+#include "fse.h"
+
+// Step used to scatter each symbol's states across the table. It is odd,
+// so it visits every slot once.
+#define FSE_SPREAD_STEP ((FSE_TABLE_SIZE >> 1) + (FSE_TABLE_SIZE >> 3) + 3)
+
+// Decoder state 'state' emits 'symbol', then moves to newState plus the
+// next 'nbBits' bits of the stream
+typedef struct FseDecodeEntry {
+    uint16_t newState;
+    unsigned char symbol;
+    unsigned char nbBits;
+} FseDecodeEntry;
+
+// Encoder transform for one symbol: the bit count for a state comes from
+// (state + deltaNbBits) >> 16, and the next state from the state table at
+// (state >> nbBits) + deltaFindState
+typedef struct FseSymbolTransform {
+    int deltaFindState;
+    uint32_t deltaNbBits;
+} FseSymbolTransform;
+
+// Writes bits LSB-first into a 64-bit register and drains whole bytes with
+// word-sized stores; 'limit' keeps those stores inside the buffer
+typedef struct FseWriter {
+    uint64_t bits;
+    int count;
+    unsigned char* ptr;
+    unsigned char* limit;
+    int overflow;
+} FseWriter;
+
+// Reads the stream from its end towards its start. 'consumed' counts the
+// bits already taken from the top of the 64-bit window loaded at 'ptr'.
+typedef struct FseReader {
+    uint64_t bits;
+    unsigned int consumed;
+    const unsigned char* ptr;
+    const unsigned char* start;
+} FseReader;
+
+static inline int highBit(uint32_t value) {
+    return 31 - __builtin_clz(value);
+}
+
+static inline void storeLE64(unsigned char* p, uint64_t value) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, &value, sizeof(value));
+#else
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(value >> (8 * i));
+#endif
+}
+
+static inline uint64_t loadLE64(const unsigned char* p) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+#else
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+#endif
+}
+
+int fseNormalizeCounts(const uint64_t freq[256], uint64_t total, short norm[256]) {
+    if (total == 0) return -1;
+    // Keep freq * FSE_TABLE_SIZE within 64 bits
+    int shift = 0;
+    while ((total >> shift) > (UINT64_MAX >> (FSE_TABLE_LOG + 1))) shift++;
+
+    int sum = 0;
+    for (int s = 0; s < 256; s++) {
+        if (freq[s] == 0) {
+            norm[s] = 0;
+            continue;
+        }
+        uint64_t scaled = ((freq[s] >> shift) * FSE_TABLE_SIZE + (total >> (shift + 1))) / (total >> shift);
+        norm[s] = scaled ? (short)scaled : 1;
+        sum += norm[s];
+    }
+
+    // Rounding and the minimum of 1 leave the sum slightly off; settle the
+    // difference on the largest counts, where it costs the least
+    while (sum != FSE_TABLE_SIZE) {
+        int largest = 0;
+        for (int s = 1; s < 256; s++) {
+            if (norm[s] > norm[largest]) largest = s;
+        }
+        if (sum < FSE_TABLE_SIZE) {
+            norm[largest] += FSE_TABLE_SIZE - sum;
+            sum = FSE_TABLE_SIZE;
+        } else {
+            int excess = sum - FSE_TABLE_SIZE;
+            int delta = excess < norm[largest] - 1 ? excess : norm[largest] - 1;
+            norm[largest] -= delta;
+            sum -= delta;
+            if (delta == 0) return -1;
+        }
+    }
+    return 0;
+}
+
+static int lastSymbol(const short norm[256]) {
+    int last = 255;
+    while (last > 0 && norm[last] == 0) last--;
+    return last;
+}
+
+static size_t headerSize(const short norm[256]) {
+    int last = lastSymbol(norm);
+    size_t size = 1;
+    for (int s = 0; s <= last; s++) {
+        size += norm[s] < 128 ? 1 : 2;
+    }
+    return size;
+}
+
+// log2(value) in 8.8 fixed point, by repeated squaring of the mantissa
+static uint32_t log2Fixed(uint32_t value) {
+    int integer = highBit(value);
+    uint64_t mantissa = (uint64_t)value << (16 - integer);   // 1.16 fixed point
+    uint32_t fraction = 0;
+    for (int i = 0; i < 8; i++) {
+        mantissa = (mantissa * mantissa) >> 16;
+        fraction <<= 1;
+        if (mantissa >= (2u << 16)) {
+            mantissa >>= 1;
+            fraction |= 1;
+        }
+    }
+    return ((uint32_t)integer << 8) | fraction;
+}
+
+size_t fseEstimateSize(const uint64_t freq[256], const short norm[256]) {
+    // A symbol with count c costs log2(TABLE_SIZE / c) bits on average
+    uint64_t cost = 0;
+    for (int s = 0; s < 256; s++) {
+        if (freq[s] == 0) continue;
+        cost += freq[s] * ((FSE_TABLE_LOG << 8) - log2Fixed((uint32_t)norm[s]));
+    }
+    return headerSize(norm) + (size_t)((cost >> 11) + ((FSE_TABLE_LOG + 8) >> 3) + 1);
+}
+
+static void spreadSymbols(const short norm[256], unsigned char spread[FSE_TABLE_SIZE]) {
+    int position = 0;
+    for (int s = 0; s < 256; s++) {
+        for (int i = 0; i < norm[s]; i++) {
+            spread[position] = (unsigned char)s;
+            position = (position + FSE_SPREAD_STEP) & (FSE_TABLE_SIZE - 1);
+        }
+    }
+}
+
+static void buildEncodeTable(const short norm[256], uint16_t stateTable[FSE_TABLE_SIZE],
+                             FseSymbolTransform transforms[256]) {
+    unsigned char spread[FSE_TABLE_SIZE];
+    int cumulative[257];
+    int next[256];
+    spreadSymbols(norm, spread);
+
+    cumulative[0] = 0;
+    for (int s = 0; s < 256; s++) {
+        cumulative[s + 1] = cumulative[s] + norm[s];
+        next[s] = cumulative[s];
+    }
+    // Each symbol's states, in table order, follow one another
+    for (int u = 0; u < FSE_TABLE_SIZE; u++) {
+        stateTable[next[spread[u]]++] = (uint16_t)(FSE_TABLE_SIZE + u);
+    }
+
+    for (int s = 0; s < 256; s++) {
+        int count = norm[s];
+        if (count == 0) continue;
+        if (count == 1) {
+            transforms[s].deltaNbBits = ((uint32_t)FSE_TABLE_LOG << 16) - FSE_TABLE_SIZE;
+            transforms[s].deltaFindState = cumulative[s] - 1;
+        } else {
+            uint32_t maxBitsOut = FSE_TABLE_LOG - highBit((uint32_t)count - 1);
+            uint32_t minStatePlus = (uint32_t)count << maxBitsOut;
+            transforms[s].deltaNbBits = (maxBitsOut << 16) - minStatePlus;
+            transforms[s].deltaFindState = cumulative[s] - count;
+        }
+    }
+}
+
+static void buildFseDecodeTable(const short norm[256], FseDecodeEntry table[FSE_TABLE_SIZE]) {
+    unsigned char spread[FSE_TABLE_SIZE];
+    uint32_t next[256];
+    spreadSymbols(norm, spread);
+    for (int s = 0; s < 256; s++) {
+        next[s] = (uint32_t)norm[s];
+    }
+    for (int u = 0; u < FSE_TABLE_SIZE; u++) {
+        unsigned char symbol = spread[u];
+        uint32_t x = next[symbol]++;
+        int nbBits = FSE_TABLE_LOG - highBit(x);
+        table[u].symbol = symbol;
+        table[u].nbBits = (unsigned char)nbBits;
+        table[u].newState = (uint16_t)((x << nbBits) - FSE_TABLE_SIZE);
+    }
+}
+
+static inline void addBits(FseWriter* writer, uint32_t value, int nbBits) {
+    writer->bits |= (uint64_t)(value & ((1u << nbBits) - 1)) << writer->count;
+    writer->count += nbBits;
+}
+
+static inline void flushWriter(FseWriter* writer) {
+    int bytes = writer->count >> 3;
+    storeLE64(writer->ptr, writer->bits);
+    writer->ptr += bytes;
+    if (writer->ptr > writer->limit) {
+        writer->ptr = writer->limit;
+        writer->overflow = 1;
+    }
+    writer->bits = bytes ? writer->bits >> (bytes * 8) : writer->bits;
+    writer->count &= 7;
+}
+
+#define ENCODE_SYMBOL(writer, state, symbol) do {                                   \
+        const FseSymbolTransform* t_ = &transforms[symbol];                         \
+        int nbBits_ = (int)(((state) + t_->deltaNbBits) >> 16);                     \
+        addBits((writer), (state), nbBits_);                                        \
+        (state) = stateTable[((state) >> nbBits_) + t_->deltaFindState];            \
+    } while (0)
+
+size_t fseCompress(const unsigned char* src, size_t srcSize, const short norm[256],
+                   unsigned char* dst, size_t capacity) {
+    size_t header = headerSize(norm);
+    if (capacity < header + 8) return 0;
+
+    int last = lastSymbol(norm);
+    unsigned char* p = dst;
+    *p++ = (unsigned char)last;
+    for (int s = 0; s <= last; s++) {
+        if (norm[s] < 128) {
+            *p++ = (unsigned char)norm[s];
+        } else {
+            *p++ = (unsigned char)(0x80 | (norm[s] >> 8));
+            *p++ = (unsigned char)(norm[s] & 0xFF);
+        }
+    }
+
+    uint16_t stateTable[FSE_TABLE_SIZE];
+    FseSymbolTransform transforms[256];
+    buildEncodeTable(norm, stateTable, transforms);
+
+    // Symbols are encoded last to first so the decoder runs forwards. At
+    // most four codes of up to FSE_TABLE_LOG bits go in between flushes.
+    FseWriter writer = {0, 0, p, dst + capacity - 8, 0};
+    uint32_t state = FSE_TABLE_SIZE;
+    size_t i = srcSize;
+    while (i & 3) {
+        i--;
+        ENCODE_SYMBOL(&writer, state, src[i]);
+    }
+    flushWriter(&writer);
+    while (i > 0 && !writer.overflow) {
+        ENCODE_SYMBOL(&writer, state, src[i - 1]);
+        ENCODE_SYMBOL(&writer, state, src[i - 2]);
+        ENCODE_SYMBOL(&writer, state, src[i - 3]);
+        ENCODE_SYMBOL(&writer, state, src[i - 4]);
+        flushWriter(&writer);
+        i -= 4;
+    }
+
+    // The final state starts the decoder; the sentinel marks the end
+    addBits(&writer, state, FSE_TABLE_LOG);
+    addBits(&writer, 1, 1);
+    flushWriter(&writer);
+    if (writer.overflow) return 0;
+    return (size_t)(writer.ptr - dst) + (writer.count > 0);
+}
+
+static int readHeader(const unsigned char* src, size_t srcSize, short norm[256], size_t* size) {
+    if (srcSize < 1) return -1;
+    int last = src[0];
+    size_t pos = 1;
+    int sum = 0;
+    memset(norm, 0, 256 * sizeof(short));
+    for (int s = 0; s <= last; s++) {
+        if (pos >= srcSize) return -1;
+        int count = src[pos++];
+        if (count & 0x80) {
+            if (pos >= srcSize) return -1;
+            count = ((count & 0x7F) << 8) | src[pos++];
+        }
+        if (count > FSE_TABLE_SIZE) return -1;
+        norm[s] = (short)count;
+        sum += count;
+    }
+    *size = pos;
+    return sum == FSE_TABLE_SIZE ? 0 : -1;
+}
+
+static inline uint32_t readBits(FseReader* reader, int nbBits) {
+    // The double shift makes a 0-bit read return 0
+    uint32_t value = (uint32_t)(((reader->bits << (reader->consumed & 63)) >> 1) >> (63 - nbBits));
+    reader->consumed += nbBits;
+    return value;
+}
+
+static inline int reloadReader(FseReader* reader) {
+    if (reader->consumed > 64) return -1;
+    if (reader->ptr - reader->start >= 8) {
+        reader->ptr -= reader->consumed >> 3;
+        reader->consumed &= 7;
+    } else if (reader->ptr == reader->start) {
+        return 0;
+    } else {
+        size_t bytes = reader->consumed >> 3;
+        if (bytes > (size_t)(reader->ptr - reader->start)) bytes = reader->ptr - reader->start;
+        reader->ptr -= bytes;
+        reader->consumed -= (unsigned int)bytes * 8;
+    }
+    reader->bits = loadLE64(reader->ptr);
+    return 0;
+}
+
+#define DECODE_FSE_SYMBOL(reader, state, out) do {                                  \
+        FseDecodeEntry entry_ = table[state];                                       \
+        (out) = entry_.symbol;                                                      \
+        (state) = entry_.newState + readBits(&(reader), entry_.nbBits);             \
+    } while (0)
+
+int fseDecompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize) {
+    short norm[256];
+    size_t header;
+    if (readHeader(src, srcSize, norm, &header) != 0) return -1;
+    const unsigned char* stream = src + header;
+    size_t streamSize = srcSize - header;
+    if (streamSize == 0 || stream[streamSize - 1] == 0) return -1;
+
+    FseDecodeEntry table[FSE_TABLE_SIZE];
+    buildFseDecodeTable(norm, table);
+
+    FseReader reader;
+    reader.start = stream;
+    if (streamSize >= 8) {
+        reader.ptr = stream + streamSize - 8;
+        reader.bits = loadLE64(reader.ptr);
+        reader.consumed = 0;
+    } else {
+        // Short streams sit in the low bytes of the window
+        reader.ptr = stream;
+        reader.bits = 0;
+        for (size_t i = 0; i < streamSize; i++) reader.bits |= (uint64_t)stream[i] << (8 * i);
+        reader.consumed = (unsigned int)(8 - streamSize) * 8;
+    }
+    // Skip the padding above the sentinel and the sentinel itself
+    reader.consumed += 8 - highBit(stream[streamSize - 1]);
+
+    uint32_t state = readBits(&reader, FSE_TABLE_LOG);
+    size_t i = 0;
+    for (; i + 4 <= dstSize; i += 4) {
+        if (reloadReader(&reader) != 0) return -1;
+        DECODE_FSE_SYMBOL(reader, state, dst[i]);
+        DECODE_FSE_SYMBOL(reader, state, dst[i + 1]);
+        DECODE_FSE_SYMBOL(reader, state, dst[i + 2]);
+        DECODE_FSE_SYMBOL(reader, state, dst[i + 3]);
+    }
+    for (; i < dstSize; i++) {
+        if (reloadReader(&reader) != 0) return -1;
+        DECODE_FSE_SYMBOL(reader, state, dst[i]);
+    }
+
+    // A well-formed stream is used up exactly
+    return reader.ptr == reader.start && reader.consumed == 64 ? 0 : -1;
+}
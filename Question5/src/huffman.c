@@ -1,417 +1,1908 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "huffman.h"
+#include "fse.h"
+#include "thread_pool.h"
 
-Node* createNode(unsigned char data, int frequency) {
-    Node* node = (Node*)malloc(sizeof(Node));
-    if (!node) {
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(1);
-    }
-    node->data = data;
-    node->frequency = frequency;
-    node->left = node->right = NULL;
-    return node;
-}
-
-MinHeap* createMinHeap(int capacity) {
-    MinHeap* heap = (MinHeap*)malloc(sizeof(MinHeap));
-    if (!heap) {
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(1);
-    }
-    heap->array = (Node**)malloc(capacity * sizeof(Node*));
-    if (!heap->array) {
-        fprintf(stderr, "Memory allocation failed\n");
-        free(heap);
-        exit(1);
-    }
-    heap->size = 0;
-    heap->capacity = capacity;
-    return heap;
-}
-
-void minHeapify(MinHeap* heap, int idx) {
-    int smallest = idx;
-    int left = 2 * idx + 1;
-    int right = 2 * idx + 2;
+// The heap holds node indices ordered by node frequency. All trees are
+// built with exactly these sift rules, so a frequency table always yields
+// the same tree; the legacy format depends on that.
+void minHeapify(MinHeap* heap, const Node nodes[], int idx) {
+    while (1) {
+        int smallest = idx;
+        int left = 2 * idx + 1;
+        int right = 2 * idx + 2;
 
-    if (left < heap->size && heap->array[left]->frequency < heap->array[smallest]->frequency)
-        smallest = left;
-    if (right < heap->size && heap->array[right]->frequency < heap->array[smallest]->frequency)
-        smallest = right;
+        if (left < heap->size && nodes[heap->array[left]].frequency < nodes[heap->array[smallest]].frequency)
+            smallest = left;
+        if (right < heap->size && nodes[heap->array[right]].frequency < nodes[heap->array[smallest]].frequency)
+            smallest = right;
+        if (smallest == idx) return;
 
-    if (smallest != idx) {
-        Node* temp = heap->array[idx];
+        short temp = heap->array[idx];
         heap->array[idx] = heap->array[smallest];
         heap->array[smallest] = temp;
-        minHeapify(heap, smallest);
+        idx = smallest;
     }
 }
 
-Node* extractMin(MinHeap* heap) {
-    if (heap->size <= 0) return NULL;
-    Node* temp = heap->array[0];
+int extractMin(MinHeap* heap, const Node nodes[]) {
+    if (heap->size <= 0) return -1;
+    int temp = heap->array[0];
     heap->array[0] = heap->array[heap->size - 1];
     heap->size--;
-    minHeapify(heap, 0);
+    minHeapify(heap, nodes, 0);
     return temp;
 }
 
-void insertMinHeap(MinHeap* heap, Node* node) {
+void insertMinHeap(MinHeap* heap, const Node nodes[], int node) {
     heap->size++;
     int i = heap->size - 1;
-    while (i && node->frequency < heap->array[(i - 1) / 2]->frequency) {
+    while (i && nodes[node].frequency < nodes[heap->array[(i - 1) / 2]].frequency) {
         heap->array[i] = heap->array[(i - 1) / 2];
         i = (i - 1) / 2;
     }
-    heap->array[i] = node;
+    heap->array[i] = (short)node;
 }
 
-void freeHuffmanTree(Node* root) {
-    if (root == NULL) return;
-    
-    // Recursively free left and right subtrees
-    freeHuffmanTree(root->left);
-    freeHuffmanTree(root->right);
-    
-    // Free the current node
-    free(root);
+// Byte histogram. Consecutive bytes go to different sub-tables so runs of
+// one value don't serialize on a single counter's load/store chain; the
+// 32-bit sub-tables are merged into the 64-bit totals every chunk, before
+// they can wrap.
+#define HISTOGRAM_TABLES 4
+#define HISTOGRAM_CHUNK (1u << 30)
+
+void countFrequencies(const unsigned char* data, size_t size, uint64_t freq[256]) {
+    uint32_t counts[HISTOGRAM_TABLES][256];
+    memset(freq, 0, 256 * sizeof(uint64_t));
+
+    while (size > 0) {
+        size_t chunk = size < HISTOGRAM_CHUNK ? size : HISTOGRAM_CHUNK;
+        memset(counts, 0, sizeof(counts));
+
+        size_t i = 0;
+        for (; i + 8 <= chunk; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            counts[0][word & 0xFF]++;
+            counts[1][(word >> 8) & 0xFF]++;
+            counts[2][(word >> 16) & 0xFF]++;
+            counts[3][(word >> 24) & 0xFF]++;
+            counts[0][(word >> 32) & 0xFF]++;
+            counts[1][(word >> 40) & 0xFF]++;
+            counts[2][(word >> 48) & 0xFF]++;
+            counts[3][word >> 56]++;
+        }
+        for (; i < chunk; i++) {
+            counts[0][data[i]]++;
+        }
+
+        for (int symbol = 0; symbol < 256; symbol++) {
+            freq[symbol] += (uint64_t)counts[0][symbol] + counts[1][symbol] +
+                            counts[2][symbol] + counts[3][symbol];
+        }
+        data += chunk;
+        size -= chunk;
+    }
 }
 
-Node* buildHuffmanTree(int freq[], int size) {
-    MinHeap* heap = createMinHeap(size);
-    
+static int addNode(HuffmanTree* tree, unsigned char data, uint64_t frequency, int left, int right) {
+    Node* node = &tree->nodes[tree->count];
+    node->frequency = frequency;
+    node->left = (short)left;
+    node->right = (short)right;
+    node->data = data;
+    return tree->count++;
+}
+
+int buildHuffmanTree(HuffmanTree* tree, const uint64_t freq[], int size) {
+    MinHeap heap;
+    heap.size = 0;
+    tree->count = 0;
+    tree->root = -1;
+
+    if (size > 256) size = 256;
     for (int i = 0; i < size; i++) {
         if (freq[i] > 0) {
-            heap->array[heap->size++] = createNode(i, freq[i]);
+            heap.array[heap.size++] = (short)addNode(tree, (unsigned char)i, freq[i], -1, -1);
         }
     }
 
-    if (heap->size == 0) {
-        free(heap->array);
-        free(heap);
-        return NULL;
-    }
+    if (heap.size == 0) return -1;
 
-    if (heap->size == 1) {
+    if (heap.size == 1) {
         // Special case: only one character in the input
-        Node* singleNode = heap->array[0];
-        free(heap->array);
-        free(heap);
-        return singleNode;
+        tree->root = heap.array[0];
+        return tree->root;
     }
 
-    for (int i = (heap->size - 1) / 2; i >= 0; i--)
-        minHeapify(heap, i);
+    for (int i = (heap.size - 1) / 2; i >= 0; i--)
+        minHeapify(&heap, tree->nodes, i);
 
-    while (heap->size > 1) {
-        Node* left = extractMin(heap);
-        Node* right = extractMin(heap);
-        
-        Node* parent = createNode('$', left->frequency + right->frequency);
-        parent->left = left;
-        parent->right = right;
-        
-        insertMinHeap(heap, parent);
+    while (heap.size > 1) {
+        int left = extractMin(&heap, tree->nodes);
+        int right = extractMin(&heap, tree->nodes);
+        uint64_t frequency = tree->nodes[left].frequency + tree->nodes[right].frequency;
+        insertMinHeap(&heap, tree->nodes, addNode(tree, '$', frequency, left, right));
     }
 
-    Node* root = extractMin(heap);
-    free(heap->array);
-    free(heap);
-    return root;
+    tree->root = extractMin(&heap, tree->nodes);
+    return tree->root;
 }
 
-// Global variables for bit operations
-static unsigned char buffer = 0;
-static int bufferBits = 0;
+static inline void storeBE64(unsigned char* p, uint64_t value) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = __builtin_bswap64(value);
+    memcpy(p, &value, sizeof(value));
+#else
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(value >> (56 - 8 * i));
+#endif
+}
 
-void writeBits(FILE* file, unsigned int bits, int numBits) {
-    while (numBits > 0) {
-        // Extract the highest bit from 'bits'
-        unsigned char bit = (bits >> (numBits - 1)) & 1;
-        
-        // Insert this bit to our buffer
-        buffer = (buffer << 1) | bit;
-        bufferBits++;
-        
-        // If buffer is full (8 bits), write it to file
-        if (bufferBits == 8) {
-            fputc(buffer, file);
-            buffer = 0;
-            bufferBits = 0;
-        }
-        
-        numBits--;
-    }
+static inline uint64_t loadBE64(const unsigned char* p) {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return __builtin_bswap64(value);
+#else
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value = (value << 8) | p[i];
+    return value;
+#endif
 }
 
-void flushBits(FILE* file) {
-    if (bufferBits > 0) {
-        // Pad remaining bits with zeros
-        buffer <<= (8 - bufferBits);
-        fputc(buffer, file);
-        buffer = 0;
-        bufferBits = 0;
+// Container fields are little-endian regardless of the host
+static void storeLE32(unsigned char* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void storeLE64(unsigned char* p, uint64_t value) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint32_t loadLE32(const unsigned char* p) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+static uint64_t loadLE64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | p[i];
+    return value;
+}
+
+void initBitWriter(BitWriter* writer, unsigned char* buffer, size_t capacity) {
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    writer->size = 0;
+    writer->bits = 0;
+    writer->count = 0;
+    writer->overflow = false;
+}
+
+// Move every complete byte of the accumulator into the output buffer with
+// a single 64-bit store; the bytes past the valid ones are overwritten later.
+static inline void drainBits(BitWriter* writer) {
+    if (writer->size + 8 > writer->capacity) {
+        writer->overflow = true;
+        writer->bits = 0;
+        writer->count = 0;
+        return;
     }
+    storeBE64(writer->buffer + writer->size, writer->bits);
+    int bytes = writer->count >> 3;
+    writer->size += bytes;
+    writer->bits <<= bytes * 8;
+    writer->count &= 7;
 }
 
-void generateCodes(Node* node, unsigned int code, unsigned char len, unsigned int codes[], unsigned char codeLengths[]) {
-    if (node == NULL) return;
-    
-    if (!node->left && !node->right) {
-        codes[node->data] = code;
-        codeLengths[node->data] = len;
+void writeBits(BitWriter* writer, unsigned int bits, int numBits) {
+    // 'bits' holds the pending bits left-aligned; at most 31 are pending on
+    // entry, so a code of up to 32 bits always fits in the register
+    if (numBits == 0) return;
+    writer->bits |= (uint64_t)bits << (64 - writer->count - numBits);
+    writer->count += numBits;
+    if (writer->count >= 32) drainBits(writer);
+}
+
+size_t flushBits(BitWriter* writer) {
+    // Pad the last partial byte with zeros
+    writer->count = (writer->count + 7) & ~7;
+    drainBits(writer);
+    writer->bits = 0;
+    writer->count = 0;
+    return writer->size;
+}
+
+void generateCodes(const HuffmanTree* tree, int node, unsigned int code, unsigned char len,
+                   unsigned int codes[], unsigned char codeLengths[]) {
+    if (node < 0) return;
+    const Node* current = &tree->nodes[node];
+
+    if (current->left < 0) {
+        codes[current->data] = code;
+        codeLengths[current->data] = len;
         return;
     }
     
     // Traverse left (add bit 0)
-    generateCodes(node->left, (code << 1), len + 1, codes, codeLengths);
+    generateCodes(tree, current->left, (code << 1), len + 1, codes, codeLengths);
     
     // Traverse right (add bit 1)
-    generateCodes(node->right, (code << 1) | 1, len + 1, codes, codeLengths);
+    generateCodes(tree, current->right, (code << 1) | 1, len + 1, codes, codeLengths);
 }
 
-int compressFile(const char* inputFile) {
-    FILE* in = fopen(inputFile, "rb");
-    if (!in) {
-        printf("Error opening input file!\n");
-        return -1;
+static int treeDepth(const HuffmanTree* tree, int node) {
+    const Node* current = &tree->nodes[node];
+    if (current->left < 0) return 0;
+    int left = treeDepth(tree, current->left);
+    int right = treeDepth(tree, current->right);
+    return 1 + (left > right ? left : right);
+}
+
+// Reserve 'count' entries at the end of the table and return their offset
+static int reserveEntries(DecodeTable* table, int count) {
+    if (table->size + count > table->capacity) {
+        int capacity = table->capacity ? table->capacity : (1 << HUFF_TABLE_BITS);
+        while (capacity < table->size + count) capacity *= 2;
+        DecodeEntry* entries = (DecodeEntry*)realloc(table->entries, capacity * sizeof(DecodeEntry));
+        if (!entries) return -1;
+        table->entries = entries;
+        table->capacity = capacity;
     }
+    int offset = table->size;
+    table->size += count;
+    return offset;
+}
 
-    // Get file size
-    fseek(in, 0, SEEK_END);
-    long fileSize = ftell(in);
-    fseek(in, 0, SEEK_SET);
+// Fill a (1 << bits)-entry table resolving the subtree below 'node'.
+// Every index is walked down the tree MSB-first; leaves reached within
+// 'bits' steps become direct entries, deeper nodes get their own subtable.
+static int buildTableLevel(DecodeTable* table, const HuffmanTree* tree, int node, int bits) {
+    int offset = reserveEntries(table, 1 << bits);
+    if (offset < 0) return -1;
 
-    if (fileSize == 0) {
-        printf("Input file is empty!\n");
-        fclose(in);
-        return -1;
+    for (int i = 0; i < (1 << bits); i++) {
+        int current = node;
+        int depth = 0;
+        while (depth < bits && tree->nodes[current].left >= 0) {
+            const Node* inner = &tree->nodes[current];
+            current = ((i >> (bits - 1 - depth)) & 1) ? inner->right : inner->left;
+            depth++;
+        }
+
+        DecodeEntry entry;
+        entry.length = depth;
+        if (tree->nodes[current].left < 0) {
+            entry.value = tree->nodes[current].data;
+            entry.subBits = 0;
+        } else {
+            int subBits = treeDepth(tree, current);
+            if (subBits > HUFF_TABLE_BITS) subBits = HUFF_TABLE_BITS;
+            int subOffset = buildTableLevel(table, tree, current, subBits);
+            if (subOffset < 0) return -1;
+            entry.value = subOffset;
+            entry.subBits = subBits;
+        }
+        table->entries[offset + i] = entry;
     }
+    return offset;
+}
 
-    FILE* out = fopen("compressed.txt", "wb");
-    if (!out) {
-        fclose(in);
-        printf("Error creating compressed file!\n");
-        return -1;
+int buildDecodeTable(const HuffmanTree* tree, DecodeTable* table) {
+    table->size = 0;
+    int depth = treeDepth(tree, tree->root);
+    table->rootBits = depth < HUFF_TABLE_BITS ? depth : HUFF_TABLE_BITS;
+    return buildTableLevel(table, tree, tree->root, table->rootBits) < 0 ? -1 : 0;
+}
+
+void freeDecodeTable(DecodeTable* table) {
+    free(table->entries);
+    table->entries = NULL;
+    table->size = table->capacity = 0;
+}
+
+void limitCodeLengths(unsigned char codeLengths[256], const uint64_t freq[256], int maxLength) {
+    // Count codes per length, folding everything deeper than the limit
+    // into the limit itself
+    int lengthCount[256] = {0};
+    int symbols[256];
+    int symbolCount = 0;
+    for (int i = 0; i < 256; i++) {
+        if (codeLengths[i] == 0) continue;
+        int length = codeLengths[i] < maxLength ? codeLengths[i] : maxLength;
+        lengthCount[length]++;
+        symbols[symbolCount++] = i;
+    }
+
+    // The folded lengths oversubscribe the code space (Kraft sum > 1).
+    // Each step drops one code from the deepest level and splits a
+    // shallower leaf into two, which shrinks the sum by 2^-maxLength.
+    unsigned int total = 0;
+    for (int length = 1; length <= maxLength; length++) {
+        total += (unsigned int)lengthCount[length] << (maxLength - length);
+    }
+    while (total > (1u << maxLength)) {
+        lengthCount[maxLength]--;
+        for (int length = maxLength - 1; length > 0; length--) {
+            if (lengthCount[length]) {
+                lengthCount[length]--;
+                lengthCount[length + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    // Hand the shortest lengths to the most frequent symbols
+    for (int i = 1; i < symbolCount; i++) {
+        int symbol = symbols[i];
+        int j = i - 1;
+        while (j >= 0 && freq[symbols[j]] < freq[symbol]) {
+            symbols[j + 1] = symbols[j];
+            j--;
+        }
+        symbols[j + 1] = symbol;
+    }
+    int next = 0;
+    for (int length = 1; length <= maxLength; length++) {
+        for (int k = 0; k < lengthCount[length]; k++) {
+            codeLengths[symbols[next++]] = length;
+        }
+    }
+}
+
+// Canonical code assignment: codes of equal length are consecutive in
+// symbol order and shorter codes sort before longer ones. Returns -1 if
+// the lengths oversubscribe the code space.
+int assignCanonicalCodes(const unsigned char codeLengths[256], unsigned int codes[256]) {
+    int lengthCount[HUFF_MAX_CODE_LENGTH + 1] = {0};
+    for (int i = 0; i < 256; i++) {
+        if (codeLengths[i] > HUFF_MAX_CODE_LENGTH) return -1;
+        lengthCount[codeLengths[i]]++;
+    }
+
+    unsigned int nextCode[HUFF_MAX_CODE_LENGTH + 1];
+    unsigned int code = 0;
+    lengthCount[0] = 0;
+    for (int length = 1; length <= HUFF_MAX_CODE_LENGTH; length++) {
+        code = (code + lengthCount[length - 1]) << 1;
+        nextCode[length] = code;
     }
+    if (code + lengthCount[HUFF_MAX_CODE_LENGTH] > (1u << HUFF_MAX_CODE_LENGTH)) return -1;
 
-    // For very small files, use direct copy instead of Huffman
-    if (fileSize <= 8) {
-        fputc(0xFF, out);  // Special marker for direct copy
-        unsigned char buffer;
-        while (fread(&buffer, 1, 1, in) == 1) {
-            fputc(buffer, out);
+    for (int i = 0; i < 256; i++) {
+        codes[i] = codeLengths[i] ? nextCode[codeLengths[i]]++ : 0;
+    }
+    return 0;
+}
+
+int buildCanonicalDecodeTable(const unsigned char codeLengths[256], DecodeTable* table) {
+    unsigned int codes[256];
+    if (assignCanonicalCodes(codeLengths, codes) != 0) return -1;
+
+    int maxLength = 0;
+    for (int i = 0; i < 256; i++) {
+        if (codeLengths[i] > maxLength) maxLength = codeLengths[i];
+    }
+    if (maxLength == 0) return -1;
+
+    // Every code fits in the root table, so no subtables are needed: a
+    // code of length L owns the 2^(maxLength - L) slots it prefixes
+    table->size = 0;
+    table->rootBits = maxLength;
+    if (reserveEntries(table, 1 << maxLength) < 0) return -1;
+    DecodeEntry unused = {0, (unsigned char)maxLength, 0};
+    for (int i = 0; i < (1 << maxLength); i++) table->entries[i] = unused;
+
+    for (int i = 0; i < 256; i++) {
+        int length = codeLengths[i];
+        if (length == 0) continue;
+        DecodeEntry entry = {(unsigned int)i, (unsigned char)length, 0};
+        unsigned int first = codes[i] << (maxLength - length);
+        for (unsigned int j = 0; j < (1u << (maxLength - length)); j++) {
+            table->entries[first + j] = entry;
         }
+    }
+    return 0;
+}
+
+// MSB-first bit reader over a memory buffer. Reads past the end yield
+// zero bits; 'pos' keeps counting so overruns can be detected afterwards.
+typedef struct BitReader {
+    const unsigned char* data;
+    size_t size;
+    size_t pos;         // Bytes absorbed into 'bits'
+    uint64_t bits;      // Pending bits, left-aligned
+    int count;          // Number of valid bits in 'bits'
+} BitReader;
+
+static inline void refillBits(BitReader* reader) {
+    if (reader->pos + 8 <= reader->size) {
+        // Load a whole word and keep the bytes that fit; the bits below
+        // 'count' are stream bits too, so OR-ing them again is harmless
+        reader->bits |= loadBE64(reader->data + reader->pos) >> reader->count;
+        int bytes = (63 - reader->count) >> 3;
+        reader->pos += bytes;
+        reader->count += bytes * 8;
     } else {
-        // Count character frequencies
-        int freq[256] = {0};
-        unsigned char ch;
-        
-        while (fread(&ch, 1, 1, in) == 1) {
-            freq[ch]++;
+        while (reader->count <= 56) {
+            uint64_t byte = reader->pos < reader->size ? reader->data[reader->pos] : 0;
+            reader->bits |= byte << (56 - reader->count);
+            reader->pos++;
+            reader->count += 8;
         }
+    }
+}
 
-        // Build Huffman tree
-        Node* root = buildHuffmanTree(freq, 256);
-        if (!root) {
-            printf("Error building Huffman tree!\n");
-            fclose(in);
-            fclose(out);
-            return -1;
+// Decode one symbol through a single-level table. The caller guarantees
+// that enough bits are buffered.
+#define DECODE_SYMBOL(reader, entries, shift, out) do {             \
+        DecodeEntry entry_ = (entries)[(reader).bits >> (shift)];   \
+        (reader).bits <<= entry_.length;                            \
+        (reader).count -= entry_.length;                            \
+        *(out)++ = (unsigned char)entry_.value;                     \
+    } while (0)
+
+// Decode 'count' symbols one at a time, following subtable links
+static void decodeSymbols(BitReader* reader, const DecodeTable* table, unsigned char* dst, size_t count) {
+    const DecodeEntry* entries = table->entries;
+    int shift = 64 - table->rootBits;
+    for (size_t i = 0; i < count; i++) {
+        if (reader->count < HUFF_TABLE_BITS) refillBits(reader);
+        DecodeEntry entry = entries[reader->bits >> shift];
+
+        // Long codes continue through one or more subtables
+        while (entry.subBits) {
+            reader->bits <<= entry.length;
+            reader->count -= entry.length;
+            if (reader->count < HUFF_TABLE_BITS) refillBits(reader);
+            entry = entries[entry.value + (reader->bits >> (64 - entry.subBits))];
         }
+        reader->bits <<= entry.length;
+        reader->count -= entry.length;
+        dst[i] = (unsigned char)entry.value;
+    }
+}
+
+static bool readerOverrun(const BitReader* reader) {
+    return reader->pos * 8 - reader->count > (uint64_t)reader->size * 8;
+}
 
-        // Generate Huffman codes
+// Decode exactly 'dstSize' symbols. Fails if the codes ran past the input.
+static int decodeHuffman(const DecodeTable* table, const unsigned char* src, size_t srcSize,
+                         unsigned char* dst, size_t dstSize) {
+    BitReader reader = {src, srcSize, 0, 0, 0};
+    const DecodeEntry* entries = table->entries;
+    int shift = 64 - table->rootBits;
+    unsigned char* out = dst;
+    unsigned char* end = dst + dstSize;
+
+    if (table->size == (1 << table->rootBits)) {
+        // Single-level table: a refill leaves at least 56 bits, enough for
+        // four codes of up to 11 bits without checking in between
+        while (end - out >= 4) {
+            refillBits(&reader);
+            DECODE_SYMBOL(reader, entries, shift, out);
+            DECODE_SYMBOL(reader, entries, shift, out);
+            DECODE_SYMBOL(reader, entries, shift, out);
+            DECODE_SYMBOL(reader, entries, shift, out);
+        }
+    }
+    decodeSymbols(&reader, table, out, end - out);
+    return readerOverrun(&reader) ? -1 : 0;
+}
+
+// Decode four interleaved bitstreams. Each stream covers a quarter of the
+// output, so the four readers are independent dependency chains the CPU
+// can advance in parallel.
+static int decodeHuffmanX4(const DecodeTable* table, const unsigned char* src, size_t srcSize,
+                           unsigned char* dst, size_t dstSize) {
+    if (srcSize < HUFF_X4_JUMP_TABLE_SIZE) return -1;
+    size_t segment = (dstSize + 3) / 4;
+    if (dstSize < 3 * segment) return -1;
+
+    BitReader readers[4];
+    unsigned char* outs[4];
+    unsigned char* ends[4];
+    const unsigned char* stream = src + HUFF_X4_JUMP_TABLE_SIZE;
+    size_t remaining = srcSize - HUFF_X4_JUMP_TABLE_SIZE;
+    for (int k = 0; k < 4; k++) {
+        size_t size = k < 3 ? loadLE32(src + 4 * k) : remaining;
+        if (size > remaining) return -1;
+        BitReader reader = {stream, size, 0, 0, 0};
+        readers[k] = reader;
+        stream += size;
+        remaining -= size;
+        outs[k] = dst + k * segment;
+        ends[k] = k < 3 ? outs[k] + segment : dst + dstSize;
+    }
+
+    const DecodeEntry* entries = table->entries;
+    int shift = 64 - table->rootBits;
+    // The last stream is the shortest; while it has four symbols left, so
+    // do the others
+    while (ends[3] - outs[3] >= 4) {
+        refillBits(&readers[0]);
+        refillBits(&readers[1]);
+        refillBits(&readers[2]);
+        refillBits(&readers[3]);
+        for (int k = 0; k < 4; k++) {
+            DECODE_SYMBOL(readers[0], entries, shift, outs[0]);
+            DECODE_SYMBOL(readers[1], entries, shift, outs[1]);
+            DECODE_SYMBOL(readers[2], entries, shift, outs[2]);
+            DECODE_SYMBOL(readers[3], entries, shift, outs[3]);
+        }
+    }
+
+    for (int k = 0; k < 4; k++) {
+        decodeSymbols(&readers[k], table, outs[k], ends[k] - outs[k]);
+        if (readerOverrun(&readers[k])) return -1;
+    }
+    return 0;
+}
+
+// Code lengths are stored as the last used symbol, then one nibble per
+// symbol up to it. Returns the number of bytes the table takes.
+static size_t codeLengthsSize(const unsigned char codeLengths[256]) {
+    int symbolCount = 0;
+    for (int i = 0; i < 256; i++) {
+        if (codeLengths[i] > 0) symbolCount = i + 1;
+    }
+    return 1 + (symbolCount + 1) / 2;
+}
+
+static size_t writeCodeLengths(unsigned char* dst, const unsigned char codeLengths[256]) {
+    size_t size = codeLengthsSize(codeLengths);
+    int symbolCount = (int)(size - 1) * 2;
+    dst[0] = (unsigned char)(symbolCount - 1);
+    for (int i = 0; i < symbolCount; i += 2) {
+        int low = i + 1 < 256 ? codeLengths[i + 1] : 0;
+        dst[1 + i / 2] = (unsigned char)((codeLengths[i] << 4) | low);
+    }
+    return size;
+}
+
+// Returns the number of bytes consumed, or 0 if the table is truncated
+static size_t readCodeLengths(const unsigned char* src, size_t srcSize, unsigned char codeLengths[256]) {
+    if (srcSize < 1) return 0;
+    int symbolCount = src[0] + 1;
+    size_t size = 1 + (symbolCount + 1) / 2;
+    if (srcSize < size) return 0;
+
+    memset(codeLengths, 0, 256);
+    for (int i = 0; i < symbolCount; i += 2) {
+        codeLengths[i] = src[1 + i / 2] >> 4;
+        if (i + 1 < symbolCount) codeLengths[i + 1] = src[1 + i / 2] & 0x0F;
+    }
+    return size;
+}
+
+// Returns the stream size, or 0 if it does not fit in 'capacity' (less the
+// 8 bytes the last store may touch)
+static size_t encodeSymbols(const unsigned char* src, size_t srcSize, const unsigned int codes[256],
+                            const unsigned char codeLengths[256], unsigned char* dst, size_t capacity) {
+    BitWriter writer;
+    initBitWriter(&writer, dst, capacity);
+    for (size_t i = 0; i < srcSize; i++) {
+        writeBits(&writer, codes[src[i]], codeLengths[src[i]]);
+    }
+    size_t size = flushBits(&writer);
+    return writer.overflow ? 0 : size;
+}
+
+size_t compressBlock(const unsigned char* src, size_t srcSize, unsigned char* dst,
+                     const HuffmanOptions* options) {
+    uint64_t freq[256];
+    countFrequencies(src, srcSize, freq);
+
+    unsigned char* payload = dst + HUFF_BLOCK_HEADER_SIZE;
+    unsigned char type = HUFF_FORMAT_STORED;
+    size_t payloadSize = srcSize;
+
+    if (freq[src[0]] == srcSize) {
+        // A run of one byte value needs only that value
+        type = HUFF_FORMAT_RLE;
+        payload[0] = src[0];
+        payloadSize = 1;
+    } else {
+        HuffmanTree tree;
+        int root = buildHuffmanTree(&tree, freq, 256);
         unsigned int codes[256] = {0};
         unsigned char codeLengths[256] = {0};
-        generateCodes(root, 0, 0, codes, codeLengths);
+        generateCodes(&tree, root, 0, 0, codes, codeLengths);
+        limitCodeLengths(codeLengths, freq, HUFF_MAX_CODE_LENGTH);
+        assignCanonicalCodes(codeLengths, codes);
 
-        // Write header - format marker
-        fputc(0x00, out);
-        
-        // Count and write unique characters
-        int uniqueChars = 0;
+        // The exact output size is known up front, so only encode when it
+        // actually beats storing the block. Four streams add the jump
+        // table and at most three bytes of padding.
+        uint64_t totalBits = 0;
         for (int i = 0; i < 256; i++) {
-            if (freq[i] > 0) uniqueChars++;
+            totalBits += freq[i] * codeLengths[i];
         }
-        fputc(uniqueChars, out);
-        
-        // Write original file size (4 bytes)
-        unsigned int size32 = (unsigned int)fileSize;
-        fwrite(&size32, sizeof(unsigned int), 1, out);
-        
-        // Write frequency table
-        for (int i = 0; i < 256; i++) {
-            if (freq[i] > 0) {
-                fputc(i, out);
-                fwrite(&freq[i], sizeof(int), 1, out);
+        size_t tableSize = codeLengthsSize(codeLengths);
+        size_t huffmanSize = tableSize + (size_t)((totalBits + 7) / 8);
+        bool interleave = options->streams == 4 && srcSize >= HUFF_X4_MIN_BLOCK_SIZE;
+        if (interleave) huffmanSize += HUFF_X4_JUMP_TABLE_SIZE + 3;
+        if (options->coder == HUFF_CODER_FSE) huffmanSize = srcSize;
+
+        // FSE is only run when its predicted size beats both alternatives,
+        // and only kept when the real size does too
+        size_t bestSize = huffmanSize < srcSize ? huffmanSize : srcSize;
+        short norm[256];
+        if (options->coder != HUFF_CODER_HUFFMAN && fseNormalizeCounts(freq, srcSize, norm) == 0 &&
+            fseEstimateSize(freq, norm) < bestSize) {
+            size_t fseSize = fseCompress(src, srcSize, norm, payload, srcSize + 8);
+            if (fseSize > 0 && fseSize < bestSize) {
+                type = HUFF_FORMAT_FSE;
+                payloadSize = fseSize;
             }
         }
 
-        // Reset buffer for bit operations
-        buffer = 0;
-        bufferBits = 0;
-        
-        // Compress data
-        fseek(in, 0, SEEK_SET);
-        while (fread(&ch, 1, 1, in) == 1) {
-            writeBits(out, codes[ch], codeLengths[ch]);
+        if (type != HUFF_FORMAT_FSE && huffmanSize < srcSize) {
+            writeCodeLengths(payload, codeLengths);
+            unsigned char* stream = payload + tableSize;
+            size_t capacity = srcSize - tableSize + 8;
+
+            if (interleave) {
+                type = HUFF_FORMAT_HUFFMAN_X4;
+                size_t segment = (srcSize + 3) / 4;
+                unsigned char* jumpTable = stream;
+                size_t written = HUFF_X4_JUMP_TABLE_SIZE;
+                for (int k = 0; k < 4 && type == HUFF_FORMAT_HUFFMAN_X4; k++) {
+                    size_t start = k * segment;
+                    size_t length = k < 3 ? segment : srcSize - start;
+                    size_t size = encodeSymbols(src + start, length, codes, codeLengths,
+                                                stream + written, capacity - written);
+                    if (size == 0) type = HUFF_FORMAT_STORED;
+                    if (k < 3) storeLE32(jumpTable + 4 * k, (uint32_t)size);
+                    written += size;
+                }
+                payloadSize = tableSize + written;
+            } else {
+                type = HUFF_FORMAT_CANONICAL;
+                size_t size = encodeSymbols(src, srcSize, codes, codeLengths, stream, capacity);
+                payloadSize = tableSize + size;
+                if (size == 0) type = HUFF_FORMAT_STORED;
+            }
+            // The size prediction was off: store the block after all
+            if (type == HUFF_FORMAT_STORED) payloadSize = srcSize;
         }
-        
-        // Write any remaining bits
-        flushBits(out);
-        
-        // Free the Huffman tree
-        freeHuffmanTree(root);
     }
 
-    fclose(in);
-    fclose(out);
+    if (type == HUFF_FORMAT_STORED) {
+        memcpy(payload, src, srcSize);
+    }
+    dst[0] = type;
+    storeLE32(dst + 1, (uint32_t)srcSize);
+    storeLE32(dst + 5, (uint32_t)payloadSize);
+    return HUFF_BLOCK_HEADER_SIZE + payloadSize;
+}
+
+// Decodes the payload of a canonical Huffman block/file: the code length
+// table followed by one bitstream, or by the jump table and four streams
+static int decodeCanonical(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize,
+                           bool interleaved) {
+    unsigned char codeLengths[256];
+    size_t tableSize = readCodeLengths(src, srcSize, codeLengths);
+    if (tableSize == 0) return -1;
+
+    DecodeTable table = {0};
+    int result = buildCanonicalDecodeTable(codeLengths, &table);
+    if (result == 0) {
+        if (interleaved) {
+            result = decodeHuffmanX4(&table, src + tableSize, srcSize - tableSize, dst, dstSize);
+        } else {
+            result = decodeHuffman(&table, src + tableSize, srcSize - tableSize, dst, dstSize);
+        }
+    }
+    freeDecodeTable(&table);
+    return result;
+}
+
+int decompressBlock(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize) {
+    if (srcSize < HUFF_BLOCK_HEADER_SIZE) return -1;
+    unsigned char type = src[0];
+    size_t rawSize = loadLE32(src + 1);
+    size_t payloadSize = loadLE32(src + 5);
+    const unsigned char* payload = src + HUFF_BLOCK_HEADER_SIZE;
+    if (rawSize != dstSize || payloadSize > srcSize - HUFF_BLOCK_HEADER_SIZE) return -1;
+
+    switch (type) {
+        case HUFF_FORMAT_STORED:
+            if (payloadSize != rawSize) return -1;
+            memcpy(dst, payload, rawSize);
+            return 0;
+        case HUFF_FORMAT_RLE:
+            if (payloadSize != 1) return -1;
+            memset(dst, payload[0], rawSize);
+            return 0;
+        case HUFF_FORMAT_CANONICAL:
+            return decodeCanonical(payload, payloadSize, dst, rawSize, false);
+        case HUFF_FORMAT_HUFFMAN_X4:
+            return decodeCanonical(payload, payloadSize, dst, rawSize, true);
+        case HUFF_FORMAT_FSE:
+            return fseDecompress(payload, payloadSize, dst, rawSize);
+        default:
+            return -1;
+    }
+}
+
+// A batch of blocks processed in parallel. Compression and streaming
+// decompression both move through their input one batch at a time, so
+// memory stays bounded by the batch size whatever the input length.
+typedef struct BlockBatch {
+    size_t count;               // Blocks in the current batch
+    size_t blockSize;
+    const unsigned char** blocks;   // Start of each input block
+    size_t* inputSizes;
+    unsigned char* input;       // One inputSlot-sized slot per block, unless
+    size_t inputSlot;           // the blocks point into a mapped file
+    unsigned char* output;      // One outputSlot-sized slot per block
+    size_t outputSlot;
+    size_t* outputSizes;
+    const HuffmanOptions* options;
+} BlockBatch;
+
+// Page-aligned allocation for the large I/O buffers
+static void* allocAligned(size_t size) {
+    void* buffer = NULL;
+    if (posix_memalign(&buffer, HUFF_IO_ALIGNMENT, size ? size : 1) != 0) return NULL;
+    return buffer;
+}
+
+static int initBlockBatch(BlockBatch* batch, size_t capacity, size_t blockSize,
+                          size_t inputSlot, size_t outputSlot) {
+    batch->count = 0;
+    batch->blockSize = blockSize;
+    batch->inputSlot = inputSlot;
+    batch->outputSlot = outputSlot;
+    batch->input = inputSlot ? (unsigned char*)allocAligned(capacity * inputSlot) : NULL;
+    batch->output = (unsigned char*)allocAligned(capacity * outputSlot);
+    batch->blocks = (const unsigned char**)malloc(capacity * sizeof(unsigned char*));
+    batch->inputSizes = (size_t*)malloc(capacity * sizeof(size_t));
+    batch->outputSizes = (size_t*)malloc(capacity * sizeof(size_t));
+    if (inputSlot && !batch->input) return -1;
+    return batch->output && batch->blocks && batch->inputSizes && batch->outputSizes ? 0 : -1;
+}
+
+static void freeBlockBatch(BlockBatch* batch) {
+    free(batch->input);
+    free(batch->output);
+    free(batch->blocks);
+    free(batch->inputSizes);
+    free(batch->outputSizes);
+}
+
+static int compressBatchTask(void* context, size_t index) {
+    BlockBatch* batch = (BlockBatch*)context;
+    batch->outputSizes[index] = compressBlock(batch->blocks[index], batch->inputSizes[index],
+                                              batch->output + index * batch->outputSlot, batch->options);
+    return 0;
+}
+
+static int decompressBatchTask(void* context, size_t index) {
+    BlockBatch* batch = (BlockBatch*)context;
+    return decompressBlock(batch->blocks[index], batch->inputSizes[index],
+                           batch->output + index * batch->outputSlot, batch->outputSizes[index]);
+}
+
+// Decodes blocks [first, first + count) of an indexed container into
+// 'output', which receives the block that starts at raw offset 'base'
+typedef struct DecompressJob {
+    const unsigned char* input;
+    const BlockIndexEntry* entries;
+    const uint64_t* rawOffsets;
+    size_t first;
+    uint64_t base;
+    unsigned char* output;
+} DecompressJob;
+
+static int decompressBlockTask(void* context, size_t index) {
+    DecompressJob* job = (DecompressJob*)context;
+    size_t block = job->first + index;
+    const BlockIndexEntry* entry = &job->entries[block];
+    return decompressBlock(job->input + entry->offset, entry->storedSize,
+                           job->output + (job->rawOffsets[block] - job->base), entry->rawSize);
+}
+
+static void resolveOptions(const HuffmanOptions* options, HuffmanOptions* resolved) {
+    resolved->blockSize = HUFF_DEFAULT_BLOCK_SIZE;
+    resolved->threads = 0;
+    resolved->streams = 1;
+    resolved->coder = HUFF_CODER_HUFFMAN;
+    if (options) *resolved = *options;
+    if (resolved->coder < HUFF_CODER_HUFFMAN || resolved->coder > HUFF_CODER_AUTO) {
+        resolved->coder = HUFF_CODER_HUFFMAN;
+    }
+    if (resolved->streams != 4) resolved->streams = 1;
+    if (resolved->blockSize < HUFF_MIN_BLOCK_SIZE) resolved->blockSize = HUFF_MIN_BLOCK_SIZE;
+    if (resolved->blockSize > HUFF_MAX_BLOCK_SIZE) resolved->blockSize = HUFF_MAX_BLOCK_SIZE;
+    if (resolved->threads <= 0) resolved->threads = defaultThreadCount();
+}
+
+static bool isStdio(const char* path) {
+    return strcmp(path, "-") == 0;
+}
+
+static FILE* openInput(const char* path) {
+    return isStdio(path) ? stdin : fopen(path, "rb");
+}
+
+static FILE* openOutput(const char* path) {
+    return isStdio(path) ? stdout : fopen(path, "wb");
+}
+
+static int closeStream(FILE* file) {
+    if (file == stdin) return 0;
+    if (file == stdout) return fflush(file);
+    return fclose(file);
+}
+
+// Reads a whole stream into memory; works on pipes as well as files
+static unsigned char* readWholeStream(FILE* file, size_t* size) {
+    size_t capacity = 1 << 16;
+    size_t length = 0;
+    unsigned char* data = (unsigned char*)malloc(capacity);
+    while (data) {
+        length += fread(data + length, 1, capacity - length, file);
+        if (length < capacity) break;
+        capacity *= 2;
+        unsigned char* grown = (unsigned char*)realloc(data, capacity);
+        if (!grown) free(data);
+        data = grown;
+    }
+    if (data && ferror(file)) {
+        free(data);
+        return NULL;
+    }
+    *size = length;
+    return data;
+}
+
 
-    // Calculate and display compression statistics
-    long compressedSize;
-    calculateFileSize("compressed.txt", &compressedSize);
-    if (compressedSize == -1) {
-        printf("Error calculating compressed file size!\n");
+// An input file held in memory: mapped when possible, otherwise read
+// into one aligned buffer
+typedef struct MappedFile {
+    unsigned char* data;
+    size_t size;
+    bool mapped;
+} MappedFile;
+
+// Returns -1 without printing anything when 'path' is stdin, cannot be
+// opened or is not a regular file; the caller then falls back to stdio.
+static int mapInputFile(const char* path, MappedFile* file) {
+    if (isStdio(path)) return -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
         return -1;
     }
 
-    printf("Original file size: %ld bytes\n", fileSize);
-    printf("Compressed file size: %ld bytes\n", compressedSize);
-    
-    float ratio = (1.0 - (float)compressedSize/fileSize) * 100;
-    printf("Compression ratio: %.2f%%\n", ratio);
+    file->size = (size_t)info.st_size;
+    file->data = NULL;
+    file->mapped = false;
+    if (file->size > 0) {
+        void* map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, file->size, MADV_SEQUENTIAL);
+            file->data = (unsigned char*)map;
+            file->mapped = true;
+        }
+    }
+
+    if (!file->mapped) {
+        // Filesystems without mmap support: one large read per chunk
+        file->data = (unsigned char*)allocAligned(file->size);
+        size_t done = 0;
+        while (file->data && done < file->size) {
+            ssize_t n = read(fd, file->data + done, file->size - done);
+            if (n <= 0) {
+                free(file->data);
+                file->data = NULL;
+                break;
+            }
+            done += (size_t)n;
+        }
+    }
+    close(fd);
+    return file->data ? 0 : -1;
+}
 
+static void unmapFile(MappedFile* file) {
+    if (file->mapped) {
+        munmap(file->data, file->size);
+    } else {
+        free(file->data);
+    }
+    file->data = NULL;
+}
+
+// Where compression reads from: a mapped file, or a stream whose first
+// bytes were already consumed into 'prefix'
+typedef struct InputSource {
+    const MappedFile* mapped;
+    size_t position;
+    FILE* file;
+    const unsigned char* prefix;
+    size_t prefixSize;
+} InputSource;
+
+// Points the batch at up to 'bytes' bytes of input. Mapped input is used
+// in place; stream input is read into the batch buffer.
+static size_t nextBatch(InputSource* source, BlockBatch* batch, size_t bytes) {
+    const unsigned char* start;
+    size_t length;
+    if (source->mapped) {
+        start = source->mapped->data + source->position;
+        length = source->mapped->size - source->position;
+        if (length > bytes) length = bytes;
+        source->position += length;
+    } else {
+        memcpy(batch->input, source->prefix, source->prefixSize);
+        length = source->prefixSize + fread(batch->input + source->prefixSize, 1,
+                                            bytes - source->prefixSize, source->file);
+        source->prefixSize = 0;
+        start = batch->input;
+    }
+
+    batch->count = (length + batch->blockSize - 1) / batch->blockSize;
+    for (size_t i = 0; i < batch->count; i++) {
+        size_t offset = i * batch->blockSize;
+        batch->blocks[i] = start + offset;
+        batch->inputSizes[i] = length - offset < batch->blockSize ? length - offset : batch->blockSize;
+    }
+    return length;
+}
+
+// Appends one entry to the growable block index
+static int appendIndexEntry(BlockIndexEntry** entries, size_t* count, size_t* capacity,
+                            uint64_t offset, size_t rawSize, size_t storedSize) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 256;
+        BlockIndexEntry* resized = (BlockIndexEntry*)realloc(*entries, grown * sizeof(BlockIndexEntry));
+        if (!resized) return -1;
+        *entries = resized;
+        *capacity = grown;
+    }
+    (*entries)[*count].offset = offset;
+    (*entries)[*count].rawSize = (uint32_t)rawSize;
+    (*entries)[*count].storedSize = (uint32_t)storedSize;
+    (*count)++;
     return 0;
 }
 
-int decompressFile(const char* inputFile) {
-    FILE* in = fopen(inputFile, "rb");
-    if (!in) {
-        printf("Error opening compressed file!\n");
+static void storeIndexEntry(unsigned char* p, uint64_t offset, uint32_t rawSize, uint32_t storedSize) {
+    storeLE64(p, offset);
+    storeLE32(p + 8, rawSize);
+    storeLE32(p + 12, storedSize);
+}
+
+static void storeFooter(unsigned char* p, uint64_t indexOffset, uint64_t blockCount, uint64_t originalSize) {
+    storeLE64(p, indexOffset);
+    storeLE64(p + 8, blockCount);
+    storeLE64(p + 16, originalSize);
+    memcpy(p + 24, HUFF_FOOTER_MAGIC, 4);
+}
+
+// Writes the end marker, the block index and the footer that locates it
+static int writeContainerTrailer(FILE* out, const BlockIndexEntry* entries, size_t blockCount,
+                                 uint64_t offset, uint64_t originalSize) {
+    unsigned char endMarker[HUFF_BLOCK_HEADER_SIZE] = {HUFF_BLOCK_END};
+    fwrite(endMarker, 1, sizeof(endMarker), out);
+    offset += sizeof(endMarker);
+
+    unsigned char entry[HUFF_INDEX_ENTRY_SIZE];
+    for (size_t i = 0; i < blockCount; i++) {
+        storeIndexEntry(entry, entries[i].offset, entries[i].rawSize, entries[i].storedSize);
+        fwrite(entry, 1, sizeof(entry), out);
+    }
+
+    unsigned char footer[HUFF_FOOTER_SIZE];
+    storeFooter(footer, offset, blockCount, originalSize);
+    fwrite(footer, 1, sizeof(footer), out);
+    return ferror(out) ? -1 : 0;
+}
+
+// Compresses the source into the block container one batch at a time.
+// Returns the number of bytes written, or -1 on failure.
+static int64_t compressBlocks(InputSource* source, FILE* out, const HuffmanOptions* opts,
+                              uint64_t* inputSize, FILE* log) {
+    size_t blockSize = opts->blockSize;
+    size_t batchBlocks = (size_t)opts->threads * 2;
+    BlockBatch batch;
+    ThreadPool* pool = createThreadPool(opts->threads);
+    BlockIndexEntry* entries = NULL;
+    size_t blockCount = 0;
+    size_t entryCapacity = 0;
+    int64_t result = -1;
+
+    if (!pool || initBlockBatch(&batch, batchBlocks, blockSize, source->mapped ? 0 : blockSize,
+                                HUFF_BLOCK_BOUND(blockSize)) != 0) {
+        fprintf(log, "Memory allocation failed\n");
+        freeThreadPool(pool);
+        freeBlockBatch(&batch);
         return -1;
     }
+    batch.options = opts;
+
+    unsigned char header[HUFF_CONTAINER_HEADER_SIZE];
+    header[0] = HUFF_FORMAT_BLOCKS;
+    storeLE32(header + 1, (uint32_t)blockSize);
+    fwrite(header, 1, sizeof(header), out);
+    uint64_t offset = HUFF_CONTAINER_HEADER_SIZE;
+    *inputSize = 0;
+
+    for (;;) {
+        size_t batchBytes = batchBlocks * blockSize;
+        size_t length = nextBatch(source, &batch, batchBytes);
+        if (source->file && ferror(source->file)) {
+            fprintf(log, "Error reading input file!\n");
+            goto cleanup;
+        }
+        if (length == 0) break;
+
+        runThreadPool(pool, batch.count, compressBatchTask, &batch);
+
+        for (size_t i = 0; i < batch.count; i++) {
+            fwrite(batch.output + i * batch.outputSlot, 1, batch.outputSizes[i], out);
+            if (appendIndexEntry(&entries, &blockCount, &entryCapacity, offset,
+                                 batch.inputSizes[i], batch.outputSizes[i]) != 0) {
+                fprintf(log, "Memory allocation failed\n");
+                goto cleanup;
+            }
+            offset += batch.outputSizes[i];
+        }
+        *inputSize += length;
+        if (length < batchBytes) break;
+    }
 
-    FILE* out = fopen("decompressed.txt", "wb");
+    if (writeContainerTrailer(out, entries, blockCount, offset, *inputSize) == 0) {
+        result = (int64_t)(offset + HUFF_BLOCK_HEADER_SIZE + blockCount * HUFF_INDEX_ENTRY_SIZE + HUFF_FOOTER_SIZE);
+    } else {
+        fprintf(log, "Error writing compressed file!\n");
+    }
+
+cleanup:
+    free(entries);
+    freeBlockBatch(&batch);
+    freeThreadPool(pool);
+    return result;
+}
+
+int compressFile(const char* inputFile, const char* outputFile, const HuffmanOptions* options) {
+    HuffmanOptions opts;
+    resolveOptions(options, &opts);
+    if (!outputFile) outputFile = "compressed.txt";
+    // Messages go to stderr when stdout carries the compressed data
+    FILE* log = isStdio(outputFile) ? stderr : stdout;
+
+    // Regular files are mapped and compressed in place; stdin and other
+    // non-seekable inputs are streamed through the batch buffer
+    MappedFile mapped;
+    InputSource source = {NULL, 0, NULL, NULL, 0};
+    unsigned char prefix[9];
+    if (mapInputFile(inputFile, &mapped) == 0) {
+        source.mapped = &mapped;
+    } else {
+        source.file = openInput(inputFile);
+        if (!source.file) {
+            fprintf(log, "Error opening input file!\n");
+            return -1;
+        }
+        // Peek at the start so tiny inputs can be recognised
+        source.prefix = prefix;
+        source.prefixSize = fread(prefix, 1, sizeof(prefix), source.file);
+    }
+
+    FILE* out = openOutput(outputFile);
     if (!out) {
-        fclose(in);
-        printf("Error creating decompressed file!\n");
+        if (source.mapped) unmapFile(&mapped);
+        else closeStream(source.file);
+        fprintf(log, "Error creating compressed file!\n");
         return -1;
     }
 
-    // Read the marker byte
-    unsigned char marker;
-    if (fread(&marker, 1, 1, in) != 1) {
-        printf("Error reading file format marker!\n");
-        fclose(in);
-        fclose(out);
+    const unsigned char* head = source.mapped ? mapped.data : prefix;
+    uint64_t fileSize = source.mapped ? mapped.size : source.prefixSize;
+    int64_t compressedSize;
+
+    // For very small files, use direct copy instead of Huffman, which is
+    // smaller than any container
+    if (fileSize > 0 && fileSize <= 8) {
+        fputc(HUFF_FORMAT_STORED, out);  // Special marker for direct copy
+        fwrite(head, 1, (size_t)fileSize, out);
+        compressedSize = ferror(out) ? -1 : (int64_t)fileSize + 1;
+    } else {
+        compressedSize = compressBlocks(&source, out, &opts, &fileSize, log);
+    }
+
+    if (source.mapped) unmapFile(&mapped);
+    else closeStream(source.file);
+    if (closeStream(out) != 0) compressedSize = -1;
+    if (compressedSize < 0) {
+        fprintf(log, "Error writing compressed file!\n");
         return -1;
     }
 
-    if (marker == 0xFF) {  // Direct copy mode
-        printf("Direct copy mode detected\n");
-        unsigned char buffer;
-        while (fread(&buffer, 1, 1, in) == 1) {
-            fputc(buffer, out);
+    fprintf(log, "Original file size: %llu bytes\n", (unsigned long long)fileSize);
+    fprintf(log, "Compressed file size: %lld bytes\n", (long long)compressedSize);
+    
+    if (fileSize > 0) {
+        float ratio = (1.0 - (double)compressedSize/fileSize) * 100;
+        fprintf(log, "Compression ratio: %.2f%%\n", ratio);
+    }
+
+    return 0;
+}
+
+// Block size recorded in a container header, or 0 if the marker is not
+// HUFF_FORMAT_BLOCKS or the size is outside the range the encoder writes
+static size_t containerBlockSize(const unsigned char header[HUFF_CONTAINER_HEADER_SIZE]) {
+    if (header[0] != HUFF_FORMAT_BLOCKS) return 0;
+    size_t blockSize = loadLE32(header + 1);
+    return blockSize >= HUFF_MIN_BLOCK_SIZE && blockSize <= HUFF_MAX_BLOCK_SIZE ? blockSize : 0;
+}
+
+// Parses and validates the footer and block index of a container
+static BlockIndexEntry* readBlockIndex(const unsigned char* data, size_t size,
+                                       size_t* blockCount, uint64_t* originalSize) {
+    if (size < HUFF_CONTAINER_HEADER_SIZE + HUFF_BLOCK_HEADER_SIZE + HUFF_FOOTER_SIZE) return NULL;
+    const unsigned char* footer = data + size - HUFF_FOOTER_SIZE;
+    if (memcmp(footer + 24, HUFF_FOOTER_MAGIC, 4) != 0) return NULL;
+
+    uint64_t indexOffset = loadLE64(footer);
+    uint64_t count = loadLE64(footer + 8);
+    *originalSize = loadLE64(footer + 16);
+    if (indexOffset > size - HUFF_FOOTER_SIZE ||
+        count != (size - HUFF_FOOTER_SIZE - indexOffset) / HUFF_INDEX_ENTRY_SIZE ||
+        count * HUFF_INDEX_ENTRY_SIZE != size - HUFF_FOOTER_SIZE - indexOffset) {
+        return NULL;
+    }
+
+    BlockIndexEntry* entries = (BlockIndexEntry*)malloc((count ? count : 1) * sizeof(BlockIndexEntry));
+    if (!entries) return NULL;
+
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        const unsigned char* entry = data + indexOffset + i * HUFF_INDEX_ENTRY_SIZE;
+        entries[i].offset = loadLE64(entry);
+        entries[i].rawSize = loadLE32(entry + 8);
+        entries[i].storedSize = loadLE32(entry + 12);
+        if (entries[i].offset > indexOffset || entries[i].storedSize > indexOffset - entries[i].offset) {
+            free(entries);
+            return NULL;
         }
-    } else if (marker == 0x00) {  // Huffman compression
-        // Read header information
-        unsigned char uniqueCharsRaw;
-        if (fread(&uniqueCharsRaw, 1, 1, in) != 1) {
-            printf("Error reading unique character count!\n");
-            fclose(in);
-            fclose(out);
-            return -1;
+        total += entries[i].rawSize;
+    }
+    if (total != *originalSize) {
+        free(entries);
+        return NULL;
+    }
+    *blockCount = (size_t)count;
+    return entries;
+}
+
+// Raw (uncompressed) start offset of every block. Returns NULL if memory
+// runs out or an entry is larger than the container's block size.
+static uint64_t* computeRawOffsets(const BlockIndexEntry* entries, size_t blockCount, size_t blockSize) {
+    uint64_t* rawOffsets = (uint64_t*)malloc((blockCount ? blockCount : 1) * sizeof(uint64_t));
+    if (!rawOffsets) return NULL;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < blockCount; i++) {
+        if (entries[i].rawSize > blockSize) {
+            free(rawOffsets);
+            return NULL;
         }
-        int uniqueChars = uniqueCharsRaw;
-        
-        // Read original file size (4 bytes)
-        unsigned int originalSize;
-        if (fread(&originalSize, sizeof(unsigned int), 1, in) != 1) {
-            printf("Error reading original file size!\n");
-            fclose(in);
-            fclose(out);
+        rawOffsets[i] = offset;
+        offset += entries[i].rawSize;
+    }
+    return rawOffsets;
+}
+
+// Index of the block containing raw offset 'offset' (binary search)
+static size_t findBlock(const uint64_t* rawOffsets, size_t blockCount, uint64_t offset) {
+    size_t low = 0;
+    size_t high = blockCount;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (rawOffsets[middle] <= offset) low = middle;
+        else high = middle;
+    }
+    return low;
+}
+
+// Decodes the raw byte range [offset, offset + length) into 'dst'. Blocks
+// wholly inside the range decode in place; the two edge blocks decode into
+// scratch slots and only their overlap is copied out.
+typedef struct RangeJob {
+    const unsigned char* input;
+    const BlockIndexEntry* entries;
+    const uint64_t* rawOffsets;
+    size_t first;
+    uint64_t offset;
+    uint64_t length;
+    unsigned char* output;
+    unsigned char* scratch;     // Two blockSize slots
+    size_t blockSize;
+} RangeJob;
+
+static int decodeRangeTask(void* context, size_t index) {
+    RangeJob* job = (RangeJob*)context;
+    size_t block = job->first + index;
+    const BlockIndexEntry* entry = &job->entries[block];
+    uint64_t start = job->rawOffsets[block];
+    uint64_t end = start + entry->rawSize;
+    uint64_t rangeEnd = job->offset + job->length;
+
+    if (start >= job->offset && end <= rangeEnd) {
+        return decompressBlock(job->input + entry->offset, entry->storedSize,
+                               job->output + (start - job->offset), entry->rawSize);
+    }
+
+    unsigned char* slot = job->scratch + (index == 0 ? 0 : job->blockSize);
+    if (decompressBlock(job->input + entry->offset, entry->storedSize, slot, entry->rawSize) != 0) {
+        return -1;
+    }
+    uint64_t from = start > job->offset ? start : job->offset;
+    uint64_t to = end < rangeEnd ? end : rangeEnd;
+    memcpy(job->output + (from - job->offset), slot + (from - start), (size_t)(to - from));
+    return 0;
+}
+
+static int decodeRange(ThreadPool* pool, const unsigned char* data, const BlockIndexEntry* entries,
+                       const uint64_t* rawOffsets, size_t blockCount, size_t blockSize,
+                       uint64_t offset, uint64_t length, unsigned char* dst) {
+    if (length == 0) return 0;
+    size_t first = findBlock(rawOffsets, blockCount, offset);
+    size_t last = findBlock(rawOffsets, blockCount, offset + length - 1);
+    RangeJob job = {data, entries, rawOffsets, first, offset, length, dst, NULL, blockSize};
+    job.scratch = (unsigned char*)malloc(2 * blockSize);
+    if (!job.scratch) return -1;
+    int result = runThreadPool(pool, last - first + 1, decodeRangeTask, &job);
+    free(job.scratch);
+    return result;
+}
+
+// Maps the output file at its final size so blocks decode straight into
+// the page cache. Returns NULL if the file cannot be mapped.
+static unsigned char* mapOutputFile(const char* path, uint64_t size, int* fd) {
+    *fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (*fd < 0) return NULL;
+    if (size > 0 && ftruncate(*fd, (off_t)size) == 0) {
+        void* map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+        if (map != MAP_FAILED) return (unsigned char*)map;
+    }
+    close(*fd);
+    *fd = -1;
+    return NULL;
+}
+
+// Decodes a container held in memory through its block index. Output is
+// decoded in place into a mapped file when possible; otherwise a window
+// of blocks at a time goes through an aligned buffer and stdio.
+static int decompressIndexed(const unsigned char* data, size_t size, const char* outputFile,
+                             const HuffmanOptions* opts, FILE* log) {
+    size_t blockCount = 0;
+    uint64_t originalSize = 0;
+    BlockIndexEntry* entries = readBlockIndex(data, size, &blockCount, &originalSize);
+    if (!entries) {
+        fprintf(log, "Invalid or truncated block index!\n");
+        return -1;
+    }
+
+    size_t blockSize = containerBlockSize(data);
+    if (blockSize == 0) {
+        fprintf(log, "Invalid block size in file header!\n");
+        free(entries);
+        return -1;
+    }
+
+    fprintf(log, "Decompressing file of size %llu bytes in %zu blocks\n",
+            (unsigned long long)originalSize, blockCount);
+
+    uint64_t* rawOffsets = computeRawOffsets(entries, blockCount, blockSize);
+    int threads = opts->threads < (int)blockCount ? opts->threads : (int)blockCount;
+    ThreadPool* pool = createThreadPool(threads);
+    int result = -1;
+    if (!rawOffsets || !pool) {
+        fprintf(log, rawOffsets ? "Memory allocation failed\n" : "Invalid block index entry!\n");
+        goto cleanup;
+    }
+
+    DecompressJob job = {data, entries, rawOffsets, 0, 0, NULL};
+    if (!isStdio(outputFile)) {
+        int fd;
+        job.output = mapOutputFile(outputFile, originalSize, &fd);
+        if (job.output) {
+            result = runThreadPool(pool, blockCount, decompressBlockTask, &job);
+            munmap(job.output, (size_t)originalSize);
+            if (close(fd) != 0) result = -1;
+            if (result != 0) fprintf(log, "Corrupted block data!\n");
+            goto cleanup;
+        }
+    }
+
+    FILE* out = openOutput(outputFile);
+    size_t windowBlocks = (size_t)threads * 2;
+    job.output = (unsigned char*)allocAligned(windowBlocks * blockSize);
+    if (!out || !job.output) {
+        fprintf(log, "Error creating decompressed file!\n");
+        if (out) closeStream(out);
+        free(job.output);
+        goto cleanup;
+    }
+
+    result = 0;
+    for (size_t first = 0; first < blockCount && result == 0; first += windowBlocks) {
+        size_t count = blockCount - first < windowBlocks ? blockCount - first : windowBlocks;
+        job.first = first;
+        job.base = rawOffsets[first];
+        result = runThreadPool(pool, count, decompressBlockTask, &job);
+        if (result == 0) {
+            uint64_t end = first + count < blockCount ? rawOffsets[first + count] : originalSize;
+            fwrite(job.output, 1, (size_t)(end - job.base), out);
+        } else {
+            fprintf(log, "Corrupted block data!\n");
+        }
+    }
+    if (closeStream(out) != 0) result = -1;
+    free(job.output);
+
+cleanup:
+    freeThreadPool(pool);
+    free(rawOffsets);
+    free(entries);
+    return result;
+}
+
+// Decodes a container front to back without seeking, one batch of blocks
+// at a time. The marker byte has already been consumed.
+static int decompressStream(FILE* in, FILE* out, const HuffmanOptions* opts, FILE* log) {
+    unsigned char header[HUFF_CONTAINER_HEADER_SIZE] = {HUFF_FORMAT_BLOCKS};
+    if (fread(header + 1, 1, sizeof(header) - 1, in) != sizeof(header) - 1) {
+        fprintf(log, "Error reading file header!\n");
+        return -1;
+    }
+    size_t blockSize = containerBlockSize(header);
+    if (blockSize == 0) {
+        fprintf(log, "Invalid block size in file header!\n");
+        return -1;
+    }
+
+    size_t batchBlocks = (size_t)opts->threads * 2;
+    BlockBatch batch;
+    ThreadPool* pool = createThreadPool(opts->threads);
+    if (!pool || initBlockBatch(&batch, batchBlocks, blockSize,
+                                HUFF_BLOCK_HEADER_SIZE + blockSize, blockSize) != 0) {
+        fprintf(log, "Memory allocation failed\n");
+        freeThreadPool(pool);
+        freeBlockBatch(&batch);
+        return -1;
+    }
+
+    int result = -1;
+    uint64_t totalSize = 0;
+    uint64_t blockCount = 0;
+    bool ended = false;
+    while (!ended) {
+        // Gather up to one batch of blocks
+        batch.count = 0;
+        while (batch.count < batchBlocks) {
+            unsigned char* slot = batch.input + batch.count * batch.inputSlot;
+            batch.blocks[batch.count] = slot;
+            if (fread(slot, 1, HUFF_BLOCK_HEADER_SIZE, in) != HUFF_BLOCK_HEADER_SIZE) {
+                fprintf(log, "Unexpected end of compressed data!\n");
+                goto cleanup;
+            }
+            size_t rawSize = loadLE32(slot + 1);
+            size_t payloadSize = loadLE32(slot + 5);
+            if (slot[0] == HUFF_BLOCK_END && rawSize == 0 && payloadSize == 0) {
+                ended = true;
+                break;
+            }
+            // No coder ever emits a payload larger than the raw block
+            if (rawSize == 0 || rawSize > blockSize || payloadSize > rawSize) {
+                fprintf(log, "Invalid block header!\n");
+                goto cleanup;
+            }
+            if (fread(slot + HUFF_BLOCK_HEADER_SIZE, 1, payloadSize, in) != payloadSize) {
+                fprintf(log, "Unexpected end of compressed data!\n");
+                goto cleanup;
+            }
+            batch.inputSizes[batch.count] = HUFF_BLOCK_HEADER_SIZE + payloadSize;
+            batch.outputSizes[batch.count] = rawSize;
+            batch.count++;
+        }
+
+        if (runThreadPool(pool, batch.count, decompressBatchTask, &batch) != 0) {
+            fprintf(log, "Corrupted block data!\n");
+            goto cleanup;
+        }
+        for (size_t i = 0; i < batch.count; i++) {
+            fwrite(batch.output + i * batch.outputSlot, 1, batch.outputSizes[i], out);
+            totalSize += batch.outputSizes[i];
+        }
+        blockCount += batch.count;
+    }
+
+    // The index is not needed front to back, but the footer confirms that
+    // nothing was lost
+    for (uint64_t i = 0; i < blockCount; i++) {
+        unsigned char entry[HUFF_INDEX_ENTRY_SIZE];
+        if (fread(entry, 1, sizeof(entry), in) != sizeof(entry)) break;
+    }
+    unsigned char footer[HUFF_FOOTER_SIZE];
+    if (fread(footer, 1, sizeof(footer), in) != sizeof(footer) ||
+        memcmp(footer + 24, HUFF_FOOTER_MAGIC, 4) != 0 ||
+        loadLE64(footer + 8) != blockCount || loadLE64(footer + 16) != totalSize) {
+        fprintf(log, "Invalid or truncated container footer!\n");
+        goto cleanup;
+    }
+    fprintf(log, "Decompressed %llu bytes in %llu blocks\n",
+            (unsigned long long)totalSize, (unsigned long long)blockCount);
+    result = 0;
+
+cleanup:
+    freeBlockBatch(&batch);
+    freeThreadPool(pool);
+    return result;
+}
+
+// Decodes the single-stream formats written before the block container;
+// 'data' holds everything after the marker byte
+static int decompressWholeFile(unsigned char marker, const unsigned char* data, size_t size, FILE* out, FILE* log) {
+    const unsigned char* end = data + size;
+    const unsigned char* p = data;
+
+    if (marker == HUFF_FORMAT_LEGACY) {  // Huffman compression, frequency header
+        if (end - p < 5) {
+            fprintf(log, "Error reading file header!\n");
             return -1;
         }
+        // The count is stored in one byte, so 256 symbols wrap to 0
+        int uniqueChars = p[0] ? p[0] : 256;
+        uint64_t originalSize = loadLE32(p + 1);
+        p += 5;
         
-        printf("Decompressing file of size %u bytes with %d unique characters\n", 
-               originalSize, uniqueChars);
+        fprintf(log, "Decompressing file of size %llu bytes with %d unique characters\n", 
+               (unsigned long long)originalSize, uniqueChars);
         
         // Read frequency table
-        int freq[256] = {0};
+        uint64_t freq[256] = {0};
         for (int i = 0; i < uniqueChars; i++) {
-            unsigned char ch;
-            int frequency;
-            
-            if (fread(&ch, 1, 1, in) != 1 || 
-                fread(&frequency, sizeof(int), 1, in) != 1) {
-                printf("Error reading frequency table entry %d\n", i);
-                fclose(in);
-                fclose(out);
+            if (end - p < 5) {
+                fprintf(log, "Error reading frequency table entry %d\n", i);
                 return -1;
             }
-            freq[ch] = frequency;
+            freq[p[0]] = loadLE32(p + 1);
+            p += 5;
         }
 
         // Build Huffman tree
-        Node* root = buildHuffmanTree(freq, 256);
-        if (!root) {
-            printf("Error building Huffman tree for decompression!\n");
-            fclose(in);
-            fclose(out);
+        HuffmanTree tree;
+        int root = buildHuffmanTree(&tree, freq, 256);
+        if (root < 0) {
+            fprintf(log, "Error building Huffman tree for decompression!\n");
             return -1;
         }
 
-        // Decompress data
-        Node* current = root;
-        unsigned int bytesWritten = 0;
-        unsigned char byte;
-        
-        while (bytesWritten < originalSize && fread(&byte, 1, 1, in) == 1) {
-            for (int i = 7; i >= 0 && bytesWritten < originalSize; i--) {
-                // Extract bit
-                unsigned char bit = (byte >> i) & 1;
-                
-                // Navigate the Huffman tree
-                current = bit ? current->right : current->left;
-                
-                // If we've reached a leaf node
-                if (!current->left && !current->right) {
-                    fputc(current->data, out);
-                    bytesWritten++;
-                    current = root;  // Reset to root
-                    
-                    // Stop if we've written all expected bytes
-                    if (bytesWritten >= originalSize) {
-                        break;
-                    }
-                }
-            }
+        unsigned char* output = (unsigned char*)malloc(originalSize ? (size_t)originalSize : 1);
+        DecodeTable table = {0};
+        int result = -1;
+        if (!output) {
+            fprintf(log, "Memory allocation failed\n");
+        } else if (tree.nodes[root].left < 0) {
+            // Single distinct byte: the encoder emitted no bits at all
+            memset(output, tree.nodes[root].data, (size_t)originalSize);
+            result = 0;
+        } else if (buildDecodeTable(&tree, &table) == 0) {
+            result = decodeHuffman(&table, p, end - p, output, (size_t)originalSize);
         }
-        
-        // Check if we decompressed the correct number of bytes
-        if (bytesWritten != originalSize) {
-            printf("Warning: Expected to decompress %u bytes, but got %u bytes\n", 
-                  originalSize, bytesWritten);
+        if (result == 0) {
+            fwrite(output, 1, (size_t)originalSize, out);
+        } else {
+            fprintf(log, "Error decoding compressed data!\n");
         }
-        
-        // Free the Huffman tree
-        freeHuffmanTree(root);
+
+        freeDecodeTable(&table);
+        free(output);
+        return result;
+    }
+
+    // HUFF_FORMAT_CANONICAL: 8-byte size, code lengths, single bitstream
+    if (end - p < 8) {
+        fprintf(log, "Error reading file header!\n");
+        return -1;
+    }
+    uint64_t originalSize = loadLE64(p);
+    p += 8;
+    fprintf(log, "Decompressing file of size %llu bytes\n", (unsigned long long)originalSize);
+
+    unsigned char* output = (unsigned char*)malloc(originalSize ? (size_t)originalSize : 1);
+    if (!output) {
+        fprintf(log, "Memory allocation failed\n");
+        return -1;
+    }
+    int result = decodeCanonical(p, end - p, output, (size_t)originalSize, false);
+    if (result == 0) {
+        fwrite(output, 1, (size_t)originalSize, out);
     } else {
-        printf("Invalid file format marker: %02X\n", marker);
-        fclose(in);
-        fclose(out);
+        fprintf(log, "Error decoding compressed data!\n");
+    }
+    free(output);
+    return result;
+}
+
+// Decodes any format from an input held in memory
+static int decompressMapped(const unsigned char* data, size_t size, const char* outputFile,
+                            const HuffmanOptions* opts, FILE* log) {
+    unsigned char marker = data[0];
+    if (marker == HUFF_FORMAT_BLOCKS) {
+        return decompressIndexed(data, size, outputFile, opts, log);
+    }
+
+    FILE* out = openOutput(outputFile);
+    if (!out) {
+        fprintf(log, "Error creating decompressed file!\n");
+        return -1;
+    }
+    int result;
+    if (marker == HUFF_FORMAT_STORED) {  // Direct copy mode
+        fprintf(log, "Direct copy mode detected\n");
+        fwrite(data + 1, 1, size - 1, out);
+        result = 0;
+    } else {
+        result = decompressWholeFile(marker, data + 1, size - 1, out, log);
+    }
+    if (closeStream(out) != 0) result = -1;
+    return result;
+}
+
+// Decodes any format from a non-seekable stream
+static int decompressStreamed(FILE* in, int marker, const char* outputFile,
+                              const HuffmanOptions* opts, FILE* log) {
+    FILE* out = openOutput(outputFile);
+    if (!out) {
+        fprintf(log, "Error creating decompressed file!\n");
         return -1;
     }
 
-    fclose(in);
-    fclose(out);
-    printf("File decompressed successfully to decompressed.txt\n");
+    int result = -1;
+    if (marker == HUFF_FORMAT_BLOCKS) {
+        result = decompressStream(in, out, opts, log);
+    } else {
+        size_t size = 0;
+        unsigned char* data = readWholeStream(in, &size);
+        if (!data) {
+            fprintf(log, "Error reading compressed file!\n");
+        } else if (marker == HUFF_FORMAT_STORED) {  // Direct copy mode
+            fprintf(log, "Direct copy mode detected\n");
+            fwrite(data, 1, size, out);
+            result = 0;
+        } else {
+            result = decompressWholeFile((unsigned char)marker, data, size, out, log);
+        }
+        free(data);
+    }
+    if (closeStream(out) != 0) result = -1;
+    return result;
+}
+
+static bool isKnownFormat(int marker) {
+    return marker == HUFF_FORMAT_STORED || marker == HUFF_FORMAT_LEGACY ||
+           marker == HUFF_FORMAT_CANONICAL || marker == HUFF_FORMAT_BLOCKS;
+}
+
+int decompressFile(const char* inputFile, const char* outputFile, const HuffmanOptions* options) {
+    HuffmanOptions opts;
+    resolveOptions(options, &opts);
+    if (!outputFile) outputFile = "decompressed.txt";
+    // Progress messages go to stderr when stdout carries the data
+    FILE* log = isStdio(outputFile) ? stderr : stdout;
+
+    int result;
+    MappedFile mapped;
+    if (mapInputFile(inputFile, &mapped) == 0) {
+        if (mapped.size < 1) {
+            fprintf(log, "Error reading file format marker!\n");
+            result = -1;
+        } else if (!isKnownFormat(mapped.data[0])) {
+            fprintf(log, "Invalid file format marker: %02X\n", mapped.data[0]);
+            result = -1;
+        } else {
+            result = decompressMapped(mapped.data, mapped.size, outputFile, &opts, log);
+        }
+        unmapFile(&mapped);
+    } else {
+        FILE* in = openInput(inputFile);
+        if (!in) {
+            fprintf(log, "Error opening compressed file!\n");
+            return -1;
+        }
+
+        // Read the marker byte
+        int marker = fgetc(in);
+        if (marker == EOF) {
+            fprintf(log, "Error reading file format marker!\n");
+            result = -1;
+        } else if (!isKnownFormat(marker)) {
+            fprintf(log, "Invalid file format marker: %02X\n", marker);
+            result = -1;
+        } else {
+            result = decompressStreamed(in, marker, outputFile, &opts, log);
+        }
+        closeStream(in);
+    }
+
+    if (result != 0) return -1;
+    fprintf(log, "File decompressed successfully to %s\n", isStdio(outputFile) ? "stdout" : outputFile);
+    return 0;
+}
+
+// In-memory API. Everything a call needs is either on its stack or in the
+// context, so independent contexts can be used from different threads.
+struct HuffmanContext {
+    HuffmanOptions options;
+    ThreadPool* pool;
+    BlockBatch batch;       // Compression scratch, allocated on first use
+    bool batchReady;
+};
+
+HuffmanContext* createHuffmanContext(const HuffmanOptions* options) {
+    HuffmanContext* ctx = (HuffmanContext*)calloc(1, sizeof(HuffmanContext));
+    if (!ctx) return NULL;
+    resolveOptions(options, &ctx->options);
+    ctx->pool = createThreadPool(ctx->options.threads);
+    if (!ctx->pool) {
+        free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void freeHuffmanContext(HuffmanContext* ctx) {
+    if (!ctx) return;
+    if (ctx->batchReady) freeBlockBatch(&ctx->batch);
+    freeThreadPool(ctx->pool);
+    free(ctx);
+}
+
+size_t huffmanCompressBound(size_t srcSize) {
+    size_t blocks = (srcSize + HUFF_MIN_BLOCK_SIZE - 1) / HUFF_MIN_BLOCK_SIZE;
+    return HUFF_CONTAINER_HEADER_SIZE + srcSize +
+           blocks * (HUFF_BLOCK_HEADER_SIZE + HUFF_INDEX_ENTRY_SIZE) +
+           HUFF_BLOCK_HEADER_SIZE + HUFF_FOOTER_SIZE;
+}
+
+int huffmanCompress(HuffmanContext* ctx, const unsigned char* src, size_t srcSize,
+                    unsigned char* dst, size_t dstCapacity, size_t* dstSize) {
+    const HuffmanOptions* opts = &ctx->options;
+    size_t blockSize = opts->blockSize;
+    size_t batchBlocks = (size_t)opts->threads * 2;
+    BlockBatch* batch = &ctx->batch;
+
+    if (!ctx->batchReady) {
+        // The blocks point into 'src', so only output slots are needed
+        if (initBlockBatch(batch, batchBlocks, blockSize, 0, HUFF_BLOCK_BOUND(blockSize)) != 0) {
+            freeBlockBatch(batch);
+            memset(batch, 0, sizeof(*batch));
+            return -1;
+        }
+        batch->options = opts;
+        ctx->batchReady = true;
+    }
+
+    if (dstCapacity < HUFF_CONTAINER_HEADER_SIZE) return -1;
+    dst[0] = HUFF_FORMAT_BLOCKS;
+    storeLE32(dst + 1, (uint32_t)blockSize);
+    size_t offset = HUFF_CONTAINER_HEADER_SIZE;
+    size_t blockCount = 0;
+
+    for (size_t position = 0; position < srcSize; ) {
+        batch->count = 0;
+        while (batch->count < batchBlocks && position < srcSize) {
+            size_t length = srcSize - position < blockSize ? srcSize - position : blockSize;
+            batch->blocks[batch->count] = src + position;
+            batch->inputSizes[batch->count] = length;
+            batch->count++;
+            position += length;
+        }
+        runThreadPool(ctx->pool, batch->count, compressBatchTask, batch);
+
+        for (size_t i = 0; i < batch->count; i++) {
+            if (batch->outputSizes[i] > dstCapacity - offset) return -1;
+            memcpy(dst + offset, batch->output + i * batch->outputSlot, batch->outputSizes[i]);
+            offset += batch->outputSizes[i];
+        }
+        blockCount += batch->count;
+    }
+
+    // The block headers carry both sizes, so the index is rebuilt by
+    // walking the blocks just written
+    size_t trailerSize = HUFF_BLOCK_HEADER_SIZE + blockCount * HUFF_INDEX_ENTRY_SIZE + HUFF_FOOTER_SIZE;
+    if (trailerSize > dstCapacity - offset) return -1;
+    unsigned char* index = dst + offset + HUFF_BLOCK_HEADER_SIZE;
+    memset(dst + offset, HUFF_BLOCK_END, HUFF_BLOCK_HEADER_SIZE);
+    size_t block = HUFF_CONTAINER_HEADER_SIZE;
+    for (size_t i = 0; i < blockCount; i++) {
+        uint32_t rawSize = loadLE32(dst + block + 1);
+        uint32_t storedSize = HUFF_BLOCK_HEADER_SIZE + loadLE32(dst + block + 5);
+        storeIndexEntry(index + i * HUFF_INDEX_ENTRY_SIZE, block, rawSize, storedSize);
+        block += storedSize;
+    }
+    storeFooter(index + blockCount * HUFF_INDEX_ENTRY_SIZE, offset + HUFF_BLOCK_HEADER_SIZE,
+                blockCount, srcSize);
+    *dstSize = offset + trailerSize;
     return 0;
 }
 
+int huffmanDecompressedSize(const unsigned char* src, size_t srcSize, uint64_t* size) {
+    if (srcSize >= 1 && src[0] == HUFF_FORMAT_STORED && srcSize <= 9) {
+        *size = srcSize - 1;
+        return 0;
+    }
+    if (srcSize < HUFF_CONTAINER_HEADER_SIZE + HUFF_BLOCK_HEADER_SIZE + HUFF_FOOTER_SIZE ||
+        src[0] != HUFF_FORMAT_BLOCKS || memcmp(src + srcSize - 4, HUFF_FOOTER_MAGIC, 4) != 0) {
+        return -1;
+    }
+    *size = loadLE64(src + srcSize - HUFF_FOOTER_SIZE + 16);
+    return 0;
+}
+
+int huffmanDecompress(HuffmanContext* ctx, const unsigned char* src, size_t srcSize,
+                      unsigned char* dst, size_t dstCapacity, size_t* dstSize) {
+    uint64_t originalSize;
+    if (huffmanDecompressedSize(src, srcSize, &originalSize) != 0 || originalSize > dstCapacity) {
+        return -1;
+    }
+    if (src[0] == HUFF_FORMAT_STORED) {
+        memcpy(dst, src + 1, (size_t)originalSize);
+        *dstSize = (size_t)originalSize;
+        return 0;
+    }
+
+    size_t blockSize = containerBlockSize(src);
+    size_t blockCount = 0;
+    BlockIndexEntry* entries = blockSize ? readBlockIndex(src, srcSize, &blockCount, &originalSize) : NULL;
+    if (!entries) return -1;
+    uint64_t* rawOffsets = computeRawOffsets(entries, blockCount, blockSize);
+    int result = -1;
+    if (rawOffsets && originalSize <= dstCapacity) {
+        DecompressJob job = {src, entries, rawOffsets, 0, 0, dst};
+        result = runThreadPool(ctx->pool, blockCount, decompressBlockTask, &job);
+    }
+    if (result == 0) *dstSize = (size_t)originalSize;
+    free(rawOffsets);
+    free(entries);
+    return result;
+}
+
+int huffmanDecompressRange(HuffmanContext* ctx, const unsigned char* src, size_t srcSize,
+                           uint64_t offset, size_t length, unsigned char* dst) {
+    if (srcSize < HUFF_CONTAINER_HEADER_SIZE) return -1;
+    size_t blockSize = containerBlockSize(src);
+    size_t blockCount = 0;
+    uint64_t originalSize = 0;
+    BlockIndexEntry* entries = blockSize ? readBlockIndex(src, srcSize, &blockCount, &originalSize) : NULL;
+    if (!entries) return -1;
+
+    uint64_t* rawOffsets = computeRawOffsets(entries, blockCount, blockSize);
+    int result = -1;
+    if (rawOffsets && offset <= originalSize && length <= originalSize - offset) {
+        result = decodeRange(ctx->pool, src, entries, rawOffsets, blockCount, blockSize, offset, length, dst);
+    }
+    free(rawOffsets);
+    free(entries);
+    return result;
+}
+
+int decompressRange(const char* inputFile, const char* outputFile, uint64_t offset, uint64_t length,
+                    const HuffmanOptions* options) {
+    HuffmanOptions opts;
+    resolveOptions(options, &opts);
+    if (!outputFile) outputFile = "decompressed.txt";
+    FILE* log = isStdio(outputFile) ? stderr : stdout;
+
+    // Random access needs the block index at the end of the input, so the
+    // whole container is mapped (or read, for pipes)
+    MappedFile mapped;
+    if (mapInputFile(inputFile, &mapped) != 0) {
+        FILE* in = openInput(inputFile);
+        if (!in) {
+            fprintf(log, "Error opening compressed file!\n");
+            return -1;
+        }
+        mapped.data = readWholeStream(in, &mapped.size);
+        mapped.mapped = false;
+        closeStream(in);
+        if (!mapped.data) {
+            fprintf(log, "Error reading compressed file!\n");
+            return -1;
+        }
+    } else if (mapped.mapped) {
+        madvise(mapped.data, mapped.size, MADV_RANDOM);
+    }
+
+    const unsigned char* data = mapped.data;
+    size_t blockCount = 0;
+    uint64_t originalSize = 0;
+    BlockIndexEntry* entries = NULL;
+    uint64_t* rawOffsets = NULL;
+    ThreadPool* pool = NULL;
+    unsigned char* window = NULL;
+    FILE* out = NULL;
+    int result = -1;
+
+    if (mapped.size < 1 || data[0] != HUFF_FORMAT_BLOCKS) {
+        fprintf(log, "Random access needs a block container (format %02X)\n", HUFF_FORMAT_BLOCKS);
+        goto cleanup;
+    }
+    size_t blockSize = mapped.size >= HUFF_CONTAINER_HEADER_SIZE ? containerBlockSize(data) : 0;
+    if (blockSize == 0) {
+        fprintf(log, "Invalid block size in file header!\n");
+        goto cleanup;
+    }
+    entries = readBlockIndex(data, mapped.size, &blockCount, &originalSize);
+    if (!entries) {
+        fprintf(log, "Invalid or truncated block index!\n");
+        goto cleanup;
+    }
+    if (offset > originalSize || length > originalSize - offset) {
+        fprintf(log, "Range %llu+%llu is outside the file (%llu bytes)\n", (unsigned long long)offset,
+                (unsigned long long)length, (unsigned long long)originalSize);
+        goto cleanup;
+    }
+
+    rawOffsets = computeRawOffsets(entries, blockCount, blockSize);
+    pool = createThreadPool(opts.threads);
+    // The range is produced one window of blocks at a time
+    size_t windowSize = (size_t)opts.threads * 2 * blockSize;
+    window = (unsigned char*)allocAligned(windowSize);
+    out = openOutput(outputFile);
+    if (!rawOffsets || !pool || !window || !out) {
+        fprintf(log, out ? "Memory allocation failed\n" : "Error creating decompressed file!\n");
+        goto cleanup;
+    }
+
+    result = 0;
+    for (uint64_t done = 0; done < length && result == 0; ) {
+        size_t chunk = length - done < windowSize ? (size_t)(length - done) : windowSize;
+        result = decodeRange(pool, data, entries, rawOffsets, blockCount, blockSize,
+                             offset + done, chunk, window);
+        if (result == 0) {
+            fwrite(window, 1, chunk, out);
+            done += chunk;
+        } else {
+            fprintf(log, "Corrupted block data!\n");
+        }
+    }
+    if (result == 0) {
+        size_t first = length ? findBlock(rawOffsets, blockCount, offset) : 0;
+        size_t last = length ? findBlock(rawOffsets, blockCount, offset + length - 1) + 1 : 0;
+        fprintf(log, "Extracted %llu bytes at offset %llu from %zu of %zu blocks\n",
+                (unsigned long long)length, (unsigned long long)offset, last - first, blockCount);
+    }
+
+cleanup:
+    if (out && closeStream(out) != 0) result = -1;
+    free(window);
+    freeThreadPool(pool);
+    free(rawOffsets);
+    free(entries);
+    unmapFile(&mapped);
+    return result;
+}
+
 void calculateFileSize(const char* fileName, long* size) {
     FILE* file = fopen(fileName, "rb");
     if (!file) {